@@ -0,0 +1,258 @@
+#define _USE_MATH_DEFINES
+#include "AsteroidField.h"
+
+#include "GLDebug.h"
+#include "GLState.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+	const GLuint instanceBinding = 0;
+	const GLuint visibleBinding = 1;
+	const GLuint commandBinding = 2;
+
+	struct Mesh {
+		std::vector<glm::vec3> verts;
+		std::vector<GLuint> indices;
+	};
+
+	// Unit icosahedron, subdivided by splitting every edge at its midpoint
+	Mesh icosphere(int subdivisions) {
+		const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+		Mesh mesh;
+		mesh.verts = {
+			{ -1,  t,  0 }, {  1,  t,  0 }, { -1, -t,  0 }, {  1, -t,  0 },
+			{  0, -1,  t }, {  0,  1,  t }, {  0, -1, -t }, {  0,  1, -t },
+			{  t,  0, -1 }, {  t,  0,  1 }, { -t,  0, -1 }, { -t,  0,  1 },
+		};
+		for (glm::vec3& v : mesh.verts) {
+			v = glm::normalize(v);
+		}
+		mesh.indices = {
+			0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+			1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+			3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+			4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1,
+		};
+
+		for (int s = 0; s < subdivisions; s++) {
+			std::map<std::pair<GLuint, GLuint>, GLuint> midpoints;
+			auto midpoint = [&](GLuint a, GLuint b) {
+				auto key = std::make_pair(std::min(a, b), std::max(a, b));
+				auto found = midpoints.find(key);
+				if (found != midpoints.end()) {
+					return found->second;
+				}
+				GLuint index = GLuint(mesh.verts.size());
+				mesh.verts.push_back(glm::normalize(mesh.verts[a] + mesh.verts[b]));
+				midpoints.emplace(key, index);
+				return index;
+			};
+
+			std::vector<GLuint> finer;
+			finer.reserve(mesh.indices.size() * 4);
+			for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+				GLuint a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+				GLuint ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+				finer.insert(finer.end(), { a, ab, ca,  b, bc, ab,  c, ca, bc,  ab, bc, ca });
+			}
+			mesh.indices = std::move(finer);
+		}
+		return mesh;
+	}
+
+	// Side planes of the frustum in eye-relative space, normalized. The far
+	// plane is at infinity and the near plane is a hair from the eye, so four
+	// planes through the eye bound everything that can be seen.
+	void frustumPlanes(const glm::mat4& PV, glm::vec4 planes[4]) {
+		glm::mat4 m = glm::transpose(PV);
+		planes[0] = m[3] + m[0];
+		planes[1] = m[3] - m[0];
+		planes[2] = m[3] + m[1];
+		planes[3] = m[3] - m[1];
+		for (int i = 0; i < 4; i++) {
+			planes[i] /= glm::length(glm::vec3(planes[i]));
+		}
+	}
+}
+
+
+AsteroidField::AsteroidField(uint32_t count, uint32_t seed)
+	: AsteroidField(belt(count, seed))
+{
+}
+
+
+AsteroidField::AsteroidField(const MinorPlanetCatalog& catalog, double julianDate)
+	: AsteroidField(fromCatalog(catalog, julianDate))
+{
+}
+
+
+std::vector<AsteroidField::Instance> AsteroidField::belt(uint32_t count, uint32_t seed) {
+	// A flattened ring in the xy plane, where the bodies orbit. Small
+	// asteroids far outnumber large ones.
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::normal_distribution<float> thickness(0.0f, 0.03f);
+	std::vector<Instance> instances(count);
+	for (Instance& instance : instances) {
+		float angle = 2.0f * float(M_PI) * unit(random);
+		float distance = 1.3f + 0.6f * unit(random);
+		float radius = 0.0008f * std::pow(8.0f, unit(random) * unit(random));
+		float shade = 0.35f + 0.3f * unit(random);
+		instance.centerRadius = glm::vec4(distance * std::cos(angle), distance * std::sin(angle), thickness(random), radius);
+		instance.color = glm::vec4(shade, shade * 0.9f, shade * 0.8f, 1.0f);
+	}
+	return instances;
+}
+
+
+std::vector<AsteroidField::Instance> AsteroidField::fromCatalog(const MinorPlanetCatalog& catalog, double julianDate) {
+	const MinorPlanetCatalog::Elements& elements = catalog.elements();
+	std::vector<Instance> instances(catalog.size());
+	for (size_t i = 0; i < instances.size(); i++) {
+		// Diameter from H at a typical albedo of 0.14, then exaggerated so
+		// even kilometre-sized bodies show up at this scale
+		float H = std::isnan(elements.absoluteMagnitude[i]) ? 15.0f : elements.absoluteMagnitude[i];
+		float diameter = 1329.0f / std::sqrt(0.14f) * std::pow(10.0f, -0.2f * H);
+		float radius = 0.0008f * std::pow(std::max(diameter, 1.0f), 0.3f);
+
+		// Lighter for the inner belt, redder further out
+		float shade = 0.5f + 0.1f * std::clamp(3.3f - elements.semiMajorAxis[i], -1.0f, 1.0f);
+		glm::vec3 center = glm::vec3(catalog.position(i, julianDate));
+		instances[i].centerRadius = glm::vec4(center, radius);
+		instances[i].color = glm::vec4(shade, shade * 0.9f, shade * 0.8f, 1.0f);
+	}
+	return instances;
+}
+
+
+AsteroidField::AsteroidField(const std::vector<Instance>& instances)
+	: lodPixels{ 48.0f, 16.0f, 4.0f }
+	, minimumPixels(0.25f)
+	, cull("shaders/asteroid_cull.comp")
+	, shader("shaders/asteroid.vert", "shaders/asteroid.frag")
+	, vao()
+	, vertexBuffer()
+	, indexBuffer()
+	, instanceBuffer()
+	, visibleBuffer()
+	, commandBuffer()
+	, commandTemplate()
+	, count(uint32_t(instances.size()))
+{
+	// The programs above already needed GL 4.3 to compile, but drivers may
+	// expose compute without the rest
+	if (!(GLEW_VERSION_4_3 || (GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_multi_draw_indirect))) {
+		Log::error("ASTEROID_FIELD needs shader storage buffers and multi-draw indirect (GL 4.3)");
+		throw std::runtime_error("GPU-driven rendering is unsupported.");
+	}
+
+	// All LODs share one vertex and index buffer, finest first
+	std::vector<glm::vec3> verts;
+	std::vector<GLuint> indices;
+	DrawElementsIndirectCommand commands[lodCount];
+	for (int lod = 0; lod < lodCount; lod++) {
+		Mesh mesh = icosphere(lodCount - 1 - lod);
+		commands[lod].count = GLuint(mesh.indices.size());
+		commands[lod].instanceCount = 0;
+		commands[lod].firstIndex = GLuint(indices.size());
+		commands[lod].baseVertex = GLint(verts.size());
+		commands[lod].baseInstance = GLuint(lod) * count;
+		verts.insert(verts.end(), mesh.verts.begin(), mesh.verts.end());
+		indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+	}
+
+	GLState::bufferData(vertexBuffer, sizeof(glm::vec3) * verts.size(), verts.data(), GL_STATIC_DRAW);
+	GLState::bufferData(instanceBuffer, sizeof(Instance) * instances.size(), instances.data(), GL_STATIC_DRAW);
+	GLState::bufferData(visibleBuffer, sizeof(GLuint) * lodCount * GLsizeiptr(count), nullptr, GL_DYNAMIC_COPY);
+	GLState::bufferData(commandBuffer, sizeof(commands), commands, GL_DYNAMIC_COPY);
+	GLState::bufferData(commandTemplate, sizeof(commands), commands, GL_STATIC_DRAW);
+	RenderStats::countUpload(sizeof(Instance) * instances.size());
+
+	// The element array binding belongs to the vertex array
+	vao.bind();
+	GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_STATIC_DRAW);
+
+	GLState::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glEnableVertexAttribArray(0);
+
+	// One visible index per instance, offset by each command's baseInstance
+	GLState::bindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+	glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, 0, (void*)0);
+	glVertexAttribDivisor(1, 1);
+	glEnableVertexAttribArray(1);
+
+	GLDebug::label(GL_BUFFER, instanceBuffer, "asteroid instances");
+	GLDebug::label(GL_BUFFER, visibleBuffer, "asteroid visible lists");
+	GLDebug::label(GL_BUFFER, commandBuffer, "asteroid draw commands");
+
+	Log::info("ASTEROID_FIELD {} asteroids, {} LODs from {} to {} triangles",
+		count, lodCount, commands[0].count / 3, commands[lodCount - 1].count / 3);
+}
+
+
+void AsteroidField::draw(const glm::mat4& V, const glm::mat4& P, glm::ivec2 viewport, const glm::dvec3& eye, const glm::dvec3& light) {
+	if (count == 0) {
+		return;
+	}
+	glm::vec3 relativeEye = glm::vec3(eye);
+	glm::vec3 relativeLight = glm::vec3(light - eye);
+
+	{
+		PROFILE_ZONE("cull");
+
+		// Zero the instance counts without the CPU touching the commands
+		GLState::bindBuffer(GL_COPY_READ_BUFFER, commandTemplate);
+		GLState::bindBuffer(GL_COPY_WRITE_BUFFER, commandBuffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(DrawElementsIndirectCommand) * lodCount);
+
+		glm::vec4 planes[4];
+		frustumPlanes(P * V, planes);
+
+		cull.use();
+		glUniform4fv(glGetUniformLocation(cull, "planes"), 4, &planes[0][0]);
+		glUniform3fv(glGetUniformLocation(cull, "eye"), 1, glm::value_ptr(relativeEye));
+		glUniform1ui(glGetUniformLocation(cull, "instanceCount"), count);
+		glUniform1f(glGetUniformLocation(cull, "pixelScale"), P[1][1] * 0.5f * float(viewport.y));
+		glUniform1fv(glGetUniformLocation(cull, "lodPixels"), lodCount - 1, lodPixels);
+		glUniform1f(glGetUniformLocation(cull, "minimumPixels"), minimumPixels);
+
+		GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, instanceBinding, instanceBuffer);
+		GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, visibleBinding, visibleBuffer);
+		GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, commandBinding, commandBuffer);
+		cull.dispatch(count);
+
+		// The lists are read as vertex attributes, the counts as draw commands
+		glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+	}
+
+	shader.use();
+	glUniformMatrix4fv(glGetUniformLocation(shader, "V"), 1, GL_FALSE, &V[0][0]);
+	glUniformMatrix4fv(glGetUniformLocation(shader, "P"), 1, GL_FALSE, &P[0][0]);
+	glUniform3fv(glGetUniformLocation(shader, "eye"), 1, glm::value_ptr(relativeEye));
+	glUniform3fv(glGetUniformLocation(shader, "light"), 1, glm::value_ptr(relativeLight));
+
+	vao.bind();
+	GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, lodCount, 0);
+
+	// One call; how many instances it drew only the GPU knows
+	RenderStats::countDraw(0);
+}
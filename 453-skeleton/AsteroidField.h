@@ -0,0 +1,97 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a GPU-driven renderer for a belt of small bodies.
+//
+// The CPU never looks at individual asteroids after creating them. Each frame
+// a compute shader tests every instance's bounding sphere against the view
+// frustum, picks a level of detail from its size on screen and appends the
+// visible ones to a per-LOD list, counting them into one
+// DrawElementsIndirectCommand per LOD. A single glMultiDrawElementsIndirect
+// then draws them all, so CPU time per frame stays the same whether the
+// belt has a hundred asteroids or millions.
+//
+// The compacted lists are read as an instanced vertex attribute, and the
+// baseInstance of each command selects the LOD's list, so the vertex shader
+// needs no draw parameters extension. Needs GL 4.3 (compute shaders, shader
+// storage buffers, multi-draw indirect); the constructor throws otherwise.
+//------------------------------------------------------------------------------
+
+#include "ComputeProgram.h"
+#include "GLHandles.h"
+#include "MinorPlanetCatalog.h"
+#include "ShaderProgram.h"
+#include "VertexArray.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+
+class AsteroidField {
+
+public:
+	// Instances are generated from the seed, so runs are repeatable
+	AsteroidField(uint32_t count, uint32_t seed = 453);
+
+	// Every object in the catalog, where it is at the Julian date
+	AsteroidField(const MinorPlanetCatalog& catalog, double julianDate);
+
+	// Because we're using the handles to do RAII for us
+	// and our other types are trivial or provide their own RAII
+	// we don't have to provide any specialized functions here. Rule of zero
+	//
+	// https://en.cppreference.com/w/cpp/language/rule_of_three
+	// https://github.com/isocpp/CppCoreGuidelines/blob/master/CppCoreGuidelines.md#Rc-zero
+
+	// Public interface
+	// Culls and draws in one go. V and P are the eye-relative view and
+	// projection, like every other renderer; light is the sun's position.
+	void draw(const glm::mat4& V, const glm::mat4& P, glm::ivec2 viewport, const glm::dvec3& eye, const glm::dvec3& light);
+
+	uint32_t getCount() const { return count; }
+
+	// Projected radius in pixels above which each LOD is used; anything
+	// smaller than the last threshold uses the coarsest mesh
+	static constexpr int lodCount = 4;
+	float lodPixels[lodCount - 1];
+
+	// Asteroids smaller than this on screen aren't drawn at all
+	float minimumPixels;
+
+private:
+	// Laid out as the std430 Instance struct in the shaders
+	struct Instance {
+		glm::vec4 centerRadius;
+		glm::vec4 color;
+	};
+
+	// Laid out as GL expects in the indirect buffer
+	struct DrawElementsIndirectCommand {
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	explicit AsteroidField(const std::vector<Instance>& instances);
+
+	static std::vector<Instance> belt(uint32_t count, uint32_t seed);
+	static std::vector<Instance> fromCatalog(const MinorPlanetCatalog& catalog, double julianDate);
+
+	ComputeProgram cull;
+	ShaderProgram shader;
+	VertexArray vao;
+
+	VertexBufferHandle vertexBuffer;
+	VertexBufferHandle indexBuffer;
+	VertexBufferHandle instanceBuffer;
+	VertexBufferHandle visibleBuffer;		// lodCount lists of count indices
+	VertexBufferHandle commandBuffer;
+	VertexBufferHandle commandTemplate;		// commands with no instances, copied over each frame
+
+	uint32_t count;
+};
@@ -0,0 +1,261 @@
+#include "Benchmark.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+
+namespace {
+
+	// p in [0, 1]; values is reordered
+	template <typename T>
+	T percentile(std::vector<T>& values, double p) {
+		if (values.empty()) {
+			return T(0);
+		}
+		size_t rank = size_t(p * double(values.size() - 1) + 0.5);
+		std::nth_element(values.begin(), values.begin() + rank, values.end());
+		return values[rank];
+	}
+
+	template <typename T>
+	double mean(const std::vector<T>& values) {
+		if (values.empty()) {
+			return 0.0;
+		}
+		return std::accumulate(values.begin(), values.end(), 0.0) / double(values.size());
+	}
+
+	std::string escape(const std::string& text) {
+		std::string escaped;
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				escaped += '\\';
+			}
+			escaped += c;
+		}
+		return escaped;
+	}
+
+	template <typename T>
+	std::string summary(std::vector<T> values) {
+		double average = mean(values);
+		auto range = std::minmax_element(values.begin(), values.end());
+		double minimum = values.empty() ? 0.0 : double(*range.first);
+		double maximum = values.empty() ? 0.0 : double(*range.second);
+		return fmt::format(
+			"{{\"min\":{:.4f},\"avg\":{:.4f},\"p50\":{:.4f},\"p90\":{:.4f},\"p95\":{:.4f},\"p99\":{:.4f},\"max\":{:.4f}}}",
+			minimum, average, double(percentile(values, 0.50)), double(percentile(values, 0.90)),
+			double(percentile(values, 0.95)), double(percentile(values, 0.99)), maximum
+		);
+	}
+}
+
+
+Benchmark::Benchmark(const std::string& scriptPath)
+	: scriptPath(scriptPath)
+	, warmupFrames(60)
+	, measuredFrames(600)
+	, frame(0)
+	, totals()
+	, lastGpuFrame(-1)
+{
+	std::ifstream file(scriptPath);
+	if (!file) {
+		Log::error("BENCHMARK unable to open {}", scriptPath);
+		throw std::runtime_error("Failed to open benchmark script.");
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream words(line);
+		std::string command;
+		if (!(words >> command)) {
+			continue;
+		}
+
+		bool ok;
+		if (command == "warmup") {
+			ok = bool(words >> warmupFrames) && warmupFrames >= 0;
+		}
+		else if (command == "frames") {
+			ok = bool(words >> measuredFrames) && measuredFrames > 0;
+		}
+		else if (command == "camera") {
+			CameraKey key;
+			ok = bool(words >> key.frame >> key.pose.theta >> key.pose.phi >> key.pose.radius);
+			cameraKeys.push_back(key);
+		}
+		else if (command == "sim") {
+			SimulationEvent event;
+			ok = bool(words >> event.frame >> event.name >> event.value);
+			ok = ok && (event.name == "focus" || event.name == "speed" ||
+				event.name == "earth_rotation" || event.name == "orbital_rotation");
+			ok = ok && (event.name != "focus" || event.value >= 0);
+			events.push_back(event);
+		}
+		else {
+			ok = false;
+		}
+
+		if (!ok) {
+			Log::error("BENCHMARK {}:{} can't parse \"{}\"", scriptPath, lineNumber, line);
+			throw std::runtime_error("Invalid benchmark script.");
+		}
+	}
+
+	if (cameraKeys.empty()) {
+		Log::error("BENCHMARK {} has no camera keys", scriptPath);
+		throw std::runtime_error("Invalid benchmark script.");
+	}
+
+	// Stable, so events on the same frame apply in file order
+	auto byFrame = [](const auto& a, const auto& b) { return a.frame < b.frame; };
+	std::stable_sort(cameraKeys.begin(), cameraKeys.end(), byFrame);
+	std::stable_sort(events.begin(), events.end(), byFrame);
+
+	frameTimes.reserve(measuredFrames);
+	Log::info("BENCHMARK {}: {} warm-up + {} measured frames, {} camera keys, {} events",
+		scriptPath, warmupFrames, measuredFrames, cameraKeys.size(), events.size());
+}
+
+
+void Benchmark::checkFocus(size_t bodyCount) const {
+	for (const SimulationEvent& event : events) {
+		if (event.name == "focus" && size_t(event.value) >= bodyCount) {
+			Log::error("BENCHMARK {} focuses body {} at frame {}, but the scene has {} bodies",
+				scriptPath, event.value, event.frame, bodyCount);
+			throw std::runtime_error("Invalid benchmark script.");
+		}
+	}
+}
+
+
+Benchmark::CameraPose Benchmark::getCamera() const {
+	int f = scriptFrame();
+
+	auto after = std::find_if(cameraKeys.begin(), cameraKeys.end(), [f](const CameraKey& key) { return key.frame > f; });
+	if (after == cameraKeys.begin()) {
+		return after->pose;
+	}
+	auto before = after - 1;
+	if (after == cameraKeys.end()) {
+		return before->pose;
+	}
+
+	float t = float(f - before->frame) / float(after->frame - before->frame);
+	return {
+		before->pose.theta + t * (after->pose.theta - before->pose.theta),
+		before->pose.phi + t * (after->pose.phi - before->pose.phi),
+		before->pose.radius + t * (after->pose.radius - before->pose.radius),
+	};
+}
+
+
+Benchmark::SimulationState Benchmark::getSimulation() const {
+	int f = scriptFrame();
+
+	SimulationState state;
+	for (const SimulationEvent& event : events) {
+		if (event.frame > f) {
+			break;
+		}
+		if (event.name == "focus") {
+			state.focus = event.value;
+		}
+		else if (event.name == "speed") {
+			state.speed = event.value;
+		}
+		else if (event.name == "earth_rotation") {
+			state.earthRotation = event.value != 0;
+		}
+		else if (event.name == "orbital_rotation") {
+			state.orbitalRotation = event.value != 0;
+		}
+	}
+	return state;
+}
+
+
+void Benchmark::addFrame(float milliseconds, const RenderStats::Counters& counters) {
+	if (frame >= warmupFrames) {
+		frameTimes.push_back(milliseconds);
+		totals.drawCalls += counters.drawCalls;
+		totals.vertices += counters.vertices;
+		totals.bytesUploaded += counters.bytesUploaded;
+		totals.textureBinds += counters.textureBinds;
+		totals.stateChanges += counters.stateChanges;
+		totals.stateSkipped += counters.stateSkipped;
+	}
+	frame++;
+}
+
+
+void Benchmark::addGpuFrame(const GpuProfiler::FrameTiming& timing) {
+	if (timing.passes.empty() || (long long)(timing.frame) <= lastGpuFrame) {
+		return;
+	}
+	lastGpuFrame = (long long)(timing.frame);
+
+	// GpuProfiler counts frames from zero too, so this skips the warm-up
+	if (timing.frame < (unsigned long long)(warmupFrames)) {
+		return;
+	}
+	for (const GpuProfiler::PassTiming& pass : timing.passes) {
+		passTimes[pass.name].push_back(pass.milliseconds);
+	}
+}
+
+
+bool Benchmark::writeReport(const std::string& path, const std::map<std::string, std::string>& context) const {
+	std::ofstream file(path);
+	if (!file) {
+		Log::error("BENCHMARK unable to write {}", path);
+		return false;
+	}
+
+	double seconds = std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0) * 1e-3;
+	double frames = double(frameTimes.size());
+	auto perSecond = [seconds](double value) { return seconds > 0.0 ? value / seconds : 0.0; };
+
+	file << "{\n";
+	file << fmt::format("  \"script\": \"{}\",\n", escape(scriptPath));
+	for (const auto& entry : context) {
+		file << fmt::format("  \"{}\": \"{}\",\n", escape(entry.first), escape(entry.second));
+	}
+	file << fmt::format("  \"warmup_frames\": {},\n", warmupFrames);
+	file << fmt::format("  \"frames\": {},\n", frameTimes.size());
+	file << fmt::format("  \"seconds\": {:.4f},\n", seconds);
+	file << fmt::format("  \"frame_ms\": {},\n", summary(frameTimes));
+	file << fmt::format(
+		"  \"throughput\": {{\"fps\":{:.2f},\"draw_calls_per_s\":{:.0f},\"vertices_per_s\":{:.0f},\"upload_bytes_per_s\":{:.0f}}},\n",
+		perSecond(frames), perSecond(double(totals.drawCalls)), perSecond(double(totals.vertices)), perSecond(double(totals.bytesUploaded))
+	);
+	auto perFrame = [frames](uint64_t value) { return frames > 0.0 ? double(value) / frames : 0.0; };
+	file << fmt::format(
+		"  \"per_frame\": {{\"draw_calls\":{:.1f},\"vertices\":{:.1f},\"upload_bytes\":{:.1f},\"texture_binds\":{:.1f},"
+		"\"state_changes\":{:.1f},\"state_skipped\":{:.1f}}},\n",
+		perFrame(totals.drawCalls), perFrame(totals.vertices), perFrame(totals.bytesUploaded), perFrame(totals.textureBinds),
+		perFrame(totals.stateChanges), perFrame(totals.stateSkipped)
+	);
+
+	file << "  \"gpu_ms\": {";
+	size_t written = 0;
+	for (const auto& pass : passTimes) {
+		file << (written++ ? "," : "") << fmt::format("\n    \"{}\": {}", escape(pass.first), summary(pass.second));
+	}
+	file << "\n  }\n}\n";
+
+	std::vector<float> sorted = frameTimes;
+	Log::info("BENCHMARK {} frames, avg {:.2f} ms, p95 {:.2f} ms, {:.1f} fps, wrote {}",
+		frameTimes.size(), mean(frameTimes), percentile(sorted, 0.95), perSecond(frames), path);
+	return true;
+}
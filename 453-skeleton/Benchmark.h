@@ -0,0 +1,92 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a scripted, repeatable render benchmark.
+//
+// A script fixes everything that normally comes from the keyboard and mouse:
+// camera keyframes (linearly interpolated) and simulation events (held until
+// the next event). After a number of warm-up frames, every frame time and
+// GPU pass timing is recorded, and writeReport() summarises them as JSON so
+// runs of different builds or machines can be compared.
+//
+// Script lines are "<command> <arguments>"; # starts a comment.
+//		warmup 60
+//		frames 600
+//		camera <frame> <theta> <phi> <radius>
+//		sim <frame> <focus|speed|earth_rotation|orbital_rotation> <value>
+// Frame numbers count measured frames; warm-up frames use frame 0.
+//------------------------------------------------------------------------------
+
+#include "GpuProfiler.h"
+#include "RenderStats.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+
+class Benchmark {
+
+public:
+	struct CameraPose {
+		float theta;
+		float phi;
+		float radius;
+	};
+
+	struct SimulationState {
+		bool earthRotation = true;
+		bool orbitalRotation = false;
+		int speed = 1;
+		int focus = 0;
+	};
+
+	explicit Benchmark(const std::string& scriptPath);
+
+	// Throws if a focus event names a body the scene doesn't have. Negative
+	// ones are already rejected when the script is read.
+	void checkFocus(size_t bodyCount) const;
+
+	// Public interface
+	bool isDone() const { return frame >= warmupFrames + measuredFrames; }
+
+	// State the script asks for on the frame about to be drawn
+	CameraPose getCamera() const;
+	SimulationState getSimulation() const;
+
+	// Called once per frame with the previous frame's time and counters
+	void addFrame(float milliseconds, const RenderStats::Counters& counters);
+
+	// GPU results arrive a few frames late; repeats of a frame are ignored
+	void addGpuFrame(const GpuProfiler::FrameTiming& timing);
+
+	// context describes the run (renderer, size, ...) and is copied as is
+	bool writeReport(const std::string& path, const std::map<std::string, std::string>& context) const;
+
+private:
+	struct CameraKey {
+		int frame;
+		CameraPose pose;
+	};
+
+	struct SimulationEvent {
+		int frame;
+		std::string name;
+		int value;
+	};
+
+	std::string scriptPath;
+	int warmupFrames;
+	int measuredFrames;
+	std::vector<CameraKey> cameraKeys;
+	std::vector<SimulationEvent> events;
+
+	int frame;
+	std::vector<float> frameTimes;
+	RenderStats::Counters totals;
+	std::map<std::string, std::vector<double>> passTimes;
+	long long lastGpuFrame;
+
+	// Script frame of the frame about to be drawn
+	int scriptFrame() const { return frame > warmupFrames ? frame - warmupFrames : 0; }
+};
@@ -0,0 +1,26 @@
+#include "BinaryCache.h"
+
+#include "Log.h"
+
+#include <fstream>
+
+
+bool BinaryCache::write(const std::string& path, const std::vector<unsigned char>& bytes, const char* tag) {
+	std::string temporary = path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(bytes.data()), std::streamsize(bytes.size()));
+		if (!file) {
+			Log::warn("{} unable to write {}, it will be rebuilt next time", tag, path);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error) {
+		Log::warn("{} unable to write {}: {}", tag, path, error.message());
+		return false;
+	}
+	return true;
+}
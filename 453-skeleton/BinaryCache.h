@@ -0,0 +1,56 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains helpers for binary caches kept next to a source file.
+//
+// A cache opens with a header holding a magic and a format version, followed
+// by whatever the owner checks to know the cache is current (a hash, a size
+// and a timestamp, ...). open() maps the cache only when it passes those
+// checks, and write() replaces it so a half-written file is never picked up.
+//
+// Example:
+//		auto cache = BinaryCache::open<Header>(cachePath, magic, version,
+//			[&](const Header& header, const MappedFile& file) { return header.hash == hash; });
+//		if (!cache) {
+//			... build the data ...
+//			BinaryCache::write(cachePath, bytes, "SCENE");
+//		}
+//------------------------------------------------------------------------------
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace BinaryCache {
+
+	// Maps path if it exists, starts with a Header carrying this magic and
+	// version, and current(header, file) agrees. Returns null otherwise.
+	template <typename Header, typename Current>
+	std::unique_ptr<MappedFile> open(const std::string& path, const char (&magic)[4], uint32_t version, Current current) {
+		std::error_code error;
+		if (!std::filesystem::exists(path, error)) {
+			return nullptr;
+		}
+
+		auto cache = std::make_unique<MappedFile>(path);
+		if (cache->size() < sizeof(Header)) {
+			return nullptr;
+		}
+		Header header;
+		std::memcpy(&header, cache->data(), sizeof(Header));
+		if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version) {
+			return nullptr;
+		}
+		return current(header, static_cast<const MappedFile&>(*cache)) ? std::move(cache) : nullptr;
+	}
+
+	// Writes to <path>.tmp and renames it over path. Failing only costs the
+	// next run a rebuild, so it logs a warning under tag and returns false.
+	bool write(const std::string& path, const std::vector<unsigned char>& bytes, const char* tag);
+}
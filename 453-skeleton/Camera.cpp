@@ -3,24 +3,32 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 
+#include <cmath>
+
 #include <iostream>
 
 #include "glm/gtc/matrix_transform.hpp"
 
-Camera::Camera(float t, float p, float r) : theta(t), phi(p), radius(r) {
+Camera::Camera(float t, float p, float r) : theta(t), phi(p), radius(r), target(0.0) {
 }
 
+glm::vec3 Camera::getOffset() const {
+	return radius * glm::vec3(std::cos(theta) * std::sin(phi), std::sin(theta), std::cos(theta) * std::cos(phi));
+}
+
+// The view is camera-relative: the eye sits at the origin and the world is
+// translated by -getPosition() (in double precision) before it gets here.
 glm::mat4 Camera::getView() {
-	glm::vec3 eye = radius * glm::vec3(std::cos(theta) * std::sin(phi), std::sin(theta), std::cos(theta) * std::cos(phi));
-	glm::vec3 at = glm::vec3(0.0f, 0.0f, 0.0f);
+	glm::vec3 eye = glm::vec3(0.0f, 0.0f, 0.0f);
+	glm::vec3 at = -getOffset();
 	glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
 
 	return glm::lookAt(eye, at, up);
 }
 
-glm::vec3 Camera::getPos() {
-	return radius * glm::vec3(std::cos(theta) * std::sin(phi), std::sin(theta), std::cos(theta) * std::cos(phi));
-}
+glm::dvec3 Camera::getPosition() const {
+	return target + glm::dvec3(getOffset());
+}
 
 void Camera::incrementTheta(float dt) {
 	if (theta + (dt / 100.0f) < M_PI_2 && theta + (dt / 100.0f) > -M_PI_2) {
@@ -37,6 +45,14 @@ void Camera::incrementPhi(float dp) {
 	}
 }
 
+void Camera::setSpherical(float t, float p, float r) {
+	theta = t;
+	phi = p;
+	radius = r;
+}
+
+// Zoom is multiplicative so the camera can get arbitrarily close to a small
+// body without ever passing through it
 void Camera::incrementR(float dr) {
-	radius -= dr;
+	radius *= std::pow(0.9f, dr);
 }
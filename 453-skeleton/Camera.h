@@ -13,14 +13,25 @@ public:
 	Camera(float t, float p, float r);
 
 	glm::mat4 getView();
-	glm::vec3 getPos();
+	glm::dvec3 getPosition() const;
+
+	// The point the camera orbits around, in world space
+	void setTarget(const glm::dvec3& t) { target = t; }
+	glm::dvec3 getTarget() const { return target; }
+
 	void incrementTheta(float dt);
 	void incrementPhi(float dp);
 	void incrementR(float dr);
 
+	// Places the camera directly, e.g. from a scripted path
+	void setSpherical(float t, float p, float r);
+
 private:
 
 	float theta;
 	float phi;
 	float radius;
+	glm::dvec3 target;
+
+	glm::vec3 getOffset() const;
 };
@@ -0,0 +1,47 @@
+#include "ComputeProgram.h"
+
+#include "GLDebug.h"
+#include "Log.h"
+
+#include <stdexcept>
+#include <vector>
+
+
+ComputeProgram::ComputeProgram(const std::string& computePath)
+	: programID()
+	, compute(computePath, GL_COMPUTE_SHADER)
+	, groupSize(1)
+{
+	attach(*this, compute);
+	glLinkProgram(programID);
+
+	GLint success;
+	glGetProgramiv(programID, GL_LINK_STATUS, &success);
+	if (!success) {
+		GLint logLength;
+		glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &logLength);
+		std::vector<char> log(logLength);
+		glGetProgramInfoLog(programID, logLength, NULL, log.data());
+
+		Log::error("COMPUTE_PROGRAM linking {}:\n{}", computePath, log.data());
+		throw std::runtime_error("Compute shader did not link.");
+	}
+	Log::info("COMPUTE_PROGRAM successfully compiled and linked {}", computePath);
+	GLDebug::label(GL_PROGRAM, programID, computePath);
+
+	// Only the x dimension is used
+	GLint size[3];
+	glGetProgramiv(programID, GL_COMPUTE_WORK_GROUP_SIZE, size);
+	groupSize = GLuint(size[0]);
+}
+
+
+void ComputeProgram::dispatch(GLuint count) const {
+	use();
+	glDispatchCompute((count + groupSize - 1) / groupSize, 1, 1);
+}
+
+
+void attach(ComputeProgram& cp, Shader& s) {
+	glAttachShader(cp.programID, s.shaderID);
+}
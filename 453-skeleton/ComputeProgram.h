@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Shader.h"
+
+#include "GLHandles.h"
+#include "GLState.h"
+
+#include <GL/glew.h>
+
+#include <string>
+
+
+// A program with a single compute shader (GL 4.3 or ARB_compute_shader)
+class ComputeProgram {
+
+public:
+	explicit ComputeProgram(const std::string& computePath);
+
+	// Because we're using the ShaderProgramHandle to do RAII for the shader for us
+	// and our other types are trivial or provide their own RAII
+	// we don't have to provide any specialized functions here. Rule of zero
+	//
+	// https://en.cppreference.com/w/cpp/language/rule_of_three
+	// https://github.com/isocpp/CppCoreGuidelines/blob/master/CppCoreGuidelines.md#Rc-zero
+
+	// Public interface
+	void use() const { GLState::useProgram(programID); }
+
+	// Runs enough work groups to cover count invocations
+	void dispatch(GLuint count) const;
+
+	void friend attach(ComputeProgram& cp, Shader& s);
+
+	operator GLuint() const { return programID; }
+
+private:
+	ShaderProgramHandle programID;
+	Shader compute;
+
+	GLuint groupSize;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains the choice between a fast and a checked OpenGL context.
+//
+// Release contexts are no-error contexts (KHR_no_error) where the driver
+// supports it, so it skips validating every call, and nothing installs the
+// debug callback, object labels or debug groups. Diagnostic contexts are
+// debug contexts with all of those turned on.
+//
+// Debug builds default to diagnostic and every other build to release;
+// --gl-mode release|diagnostic picks one at runtime.
+//------------------------------------------------------------------------------
+
+#include "Log.h"
+
+#include <stdexcept>
+#include <string>
+
+#ifndef ORRERY_DIAGNOSTIC_DEFAULT
+#define ORRERY_DIAGNOSTIC_DEFAULT 0
+#endif
+
+
+enum class ContextMode {
+	Release,
+	Diagnostic,
+};
+
+
+inline ContextMode defaultContextMode() {
+	return ORRERY_DIAGNOSTIC_DEFAULT ? ContextMode::Diagnostic : ContextMode::Release;
+}
+
+
+inline const char* contextModeName(ContextMode mode) {
+	return mode == ContextMode::Diagnostic ? "diagnostic" : "release";
+}
+
+
+inline ContextMode parseContextMode(const std::string& name) {
+	if (name == "release") {
+		return ContextMode::Release;
+	}
+	if (name == "diagnostic") {
+		return ContextMode::Diagnostic;
+	}
+	Log::error("CONTEXT unknown mode {}, expected release or diagnostic", name);
+	throw std::runtime_error("Unknown context mode.");
+}
@@ -0,0 +1,98 @@
+#include "Cubemap.h"
+
+#include "GLDebug.h"
+
+#include <stb/stb_image.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+
+namespace {
+
+	// Direction through texel (u, v) of a face, u and v in [-1, 1]. Follows the
+	// face orientation table from the OpenGL specification (8.13, Cube Map
+	// Texture Selection), so row 0 of each face is uploaded first.
+	glm::vec3 faceDirection(int face, float u, float v) {
+		switch (face) {
+			case 0:  return glm::vec3(1.0f, -v, -u);   // +X
+			case 1:  return glm::vec3(-1.0f, -v, u);   // -X
+			case 2:  return glm::vec3(u, 1.0f, v);     // +Y
+			case 3:  return glm::vec3(u, -1.0f, -v);   // -Y
+			case 4:  return glm::vec3(u, -v, 1.0f);    // +Z
+			default: return glm::vec3(-u, -v, -1.0f);  // -Z
+		}
+	}
+
+	// Bilinear lookup into the panorama, wrapping horizontally
+	void samplePanorama(const unsigned char* image, int width, int height, int components,
+	                    float s, float t, unsigned char* out) {
+		float x = s * width - 0.5f;
+		float y = std::clamp(t * height - 0.5f, 0.0f, float(height - 1));
+
+		int x0 = int(std::floor(x));
+		int y0 = int(y);
+		float fx = x - x0;
+		float fy = y - y0;
+
+		int x1 = ((x0 + 1) % width + width) % width;
+		x0 = (x0 % width + width) % width;
+		int y1 = std::min(y0 + 1, height - 1);
+
+		for (int c = 0; c < components; c++) {
+			float top = image[(y0 * width + x0) * components + c] * (1.0f - fx) + image[(y0 * width + x1) * components + c] * fx;
+			float bottom = image[(y1 * width + x0) * components + c] * (1.0f - fx) + image[(y1 * width + x1) * components + c] * fx;
+			out[c] = static_cast<unsigned char>(top * (1.0f - fy) + bottom * fy + 0.5f);
+		}
+	}
+}
+
+
+Cubemap::Cubemap(std::string path, int faceSize)
+	: textureID(GL_TEXTURE_CUBE_MAP), path(path), faceSize(faceSize)
+{
+	int width, height, numComponents;
+	stbi_set_flip_vertically_on_load(false);
+	unsigned char* data = stbi_load(path.c_str(), &width, &height, &numComponents, 3);
+	if (data == nullptr) {
+		throw std::runtime_error("Failed to read cubemap panorama from file!");
+	}
+
+	const float PI = 3.14159265359f;
+	std::vector<unsigned char> face(faceSize * faceSize * 3);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);		//Set alignment to be 1
+	bind();
+
+	for (int f = 0; f < 6; f++) {
+		for (int y = 0; y < faceSize; y++) {
+			for (int x = 0; x < faceSize; x++) {
+				float u = 2.0f * (x + 0.5f) / faceSize - 1.0f;
+				float v = 2.0f * (y + 0.5f) / faceSize - 1.0f;
+				glm::vec3 d = glm::normalize(faceDirection(f, u, v));
+
+				float s = std::atan2(d.z, d.x) / (2.0f * PI) + 0.5f;
+				float t = 0.5f - std::asin(d.y) / PI;
+				samplePanorama(data, width, height, 3, s, t, &face[(y * faceSize + x) * 3]);
+			}
+		}
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, 0, GL_RGB, faceSize, faceSize, 0, GL_RGB, GL_UNSIGNED_BYTE, face.data());
+	}
+
+	GLDebug::label(GL_TEXTURE, textureID, path);
+
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// Clean up
+	unbind();
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);	//Return to default alignment
+	stbi_image_free(data);
+}
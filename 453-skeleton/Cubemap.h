@@ -0,0 +1,33 @@
+#pragma once
+
+#include "GLHandles.h"
+#include "GLState.h"
+#include <GL/glew.h>
+#include <string>
+
+
+// A cube map texture built from a single equirectangular (longitude/latitude)
+// panorama. The six faces are resampled on the CPU once, at load time.
+class Cubemap {
+public:
+	Cubemap(std::string path, int faceSize);
+
+	// Because we're using the TextureHandle to do RAII for the texture for us
+	// and our other types are trivial or provide their own RAII
+	// we don't have to provide any specialized functions here. Rule of zero
+	//
+	// https://en.cppreference.com/w/cpp/language/rule_of_three
+	// https://github.com/isocpp/CppCoreGuidelines/blob/master/CppCoreGuidelines.md#Rc-zero
+
+	// Public interface
+	std::string getPath() const { return path; }
+	int getFaceSize() const { return faceSize; }
+
+	void bind(GLuint unit = 0) { GLState::bindTexture(unit, GL_TEXTURE_CUBE_MAP, textureID); }
+	void unbind(GLuint unit = 0) { GLState::bindTexture(unit, GL_TEXTURE_CUBE_MAP, 0); }
+
+private:
+	TextureHandle textureID;
+	std::string path;
+	int faceSize;
+};
@@ -0,0 +1,189 @@
+#include "Ephemeris.h"
+
+#include "Frames.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace {
+
+	const char* const names[Ephemeris::bodyCount] = {
+		"mercury", "venus", "earth-moon", "mars", "jupiter", "saturn", "uranus", "neptune", "pluto",
+		"moon", "sun", "earth",
+	};
+
+	const int naifIds[Ephemeris::bodyCount] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 301, 10, 399 };
+
+	const uint32_t earthMoonSeries = uint32_t(Ephemeris::Body::EarthMoonBarycenter);
+	const uint32_t moonSeries = uint32_t(Ephemeris::Body::Moon);
+}
+
+
+Ephemeris::Ephemeris(const std::string& path)
+	: file(path)
+	, header{}
+	, series(nullptr)
+	, records(nullptr)
+{
+	const size_t tableEnd = sizeof(EphemerisFile::Header) + sizeof(EphemerisFile::Series) * EphemerisFile::seriesCount;
+	bool valid = file.size() >= tableEnd;
+	if (valid) {
+		std::memcpy(&header, file.data(), sizeof(header));
+		valid = std::memcmp(header.magic, EphemerisFile::magic, sizeof(header.magic)) == 0
+			&& header.version == EphemerisFile::version
+			&& header.seriesCount == EphemerisFile::seriesCount
+			&& header.recordCount > 0
+			&& header.intervalDays > 0.0
+			&& file.size() == tableEnd + sizeof(double) * size_t(header.recordCount) * header.recordDoubles;
+	}
+	if (valid) {
+		series = reinterpret_cast<const EphemerisFile::Series*>(file.data() + sizeof(EphemerisFile::Header));
+		for (uint32_t s = 0; s < EphemerisFile::seriesCount; s++) {
+			valid = valid && series[s].coefficients > 0 && series[s].subintervals > 0
+				&& series[s].offset + 3 * series[s].coefficients * series[s].subintervals <= header.recordDoubles;
+		}
+	}
+	if (!valid) {
+		Log::error("EPHEMERIS {} is not an ephemeris written by ephconv", path);
+		throw std::runtime_error("Invalid ephemeris.");
+	}
+	records = reinterpret_cast<const double*>(file.data() + tableEnd);
+
+	Log::info("EPHEMERIS DE{} from JD {} to {} in {} records", header.denumber, startJD(), endJD(), header.recordCount);
+}
+
+
+const double* Ephemeris::locate(double jd, double& normalized) const {
+	if (!covers(jd)) {
+		Log::error("EPHEMERIS JD {} is outside {} to {}", jd, startJD(), endJD());
+		throw std::runtime_error("Epoch outside the ephemeris.");
+	}
+
+	// Records are all the same length, so this is the only lookup; the very
+	// end of the span belongs to the last record
+	double t = (jd - header.startJD) / header.intervalDays;
+	size_t record = std::min(size_t(t), size_t(header.recordCount) - 1);
+	normalized = t - double(record);
+	return records + record * header.recordDoubles;
+}
+
+
+Ephemeris::State Ephemeris::evaluate(const double* record, double normalized, uint32_t index) const {
+	const EphemerisFile::Series& s = series[index];
+	const uint32_t n = s.coefficients;
+
+	double scaled = normalized * s.subintervals;
+	uint32_t sub = std::min(uint32_t(scaled), s.subintervals - 1);
+	double x = 2.0 * (scaled - sub) - 1.0;
+	const double* c = record + s.offset + 3 * n * sub;
+
+	// Clenshaw for the series and, differentiated term by term, its slope.
+	// The coefficients are interleaved, so each step works on x, y and z at
+	// once and the inner loop vectorizes.
+	double b1[3] = {}, b2[3] = {}, d1[3] = {}, d2[3] = {};
+	const double twoX = 2.0 * x;
+	for (uint32_t k = n - 1; k >= 1; k--) {
+		const double* ck = c + 3 * k;
+		for (int i = 0; i < 3; i++) {
+			double b = ck[i] + twoX * b1[i] - b2[i];
+			double d = 2.0 * b1[i] + twoX * d1[i] - d2[i];
+			b2[i] = b1[i];
+			b1[i] = b;
+			d2[i] = d1[i];
+			d1[i] = d;
+		}
+	}
+
+	// d/dt of x, which runs over [-1, 1] across each subinterval
+	const double rate = 2.0 * s.subintervals / header.intervalDays;
+	State state;
+	for (int i = 0; i < 3; i++) {
+		state.position[i] = c[i] + x * b1[i] - b2[i];
+		state.velocity[i] = (b1[i] + x * d1[i] - d2[i]) * rate;
+	}
+	return state;
+}
+
+
+Ephemeris::State Ephemeris::state(Body body, double jd) const {
+	double normalized;
+	const double* record = locate(jd, normalized);
+	if (body != Body::Earth && body != Body::Moon) {
+		return evaluate(record, normalized, uint32_t(body));
+	}
+
+	// The Earth and the Moon are split about their barycentre by mass
+	State barycenter = evaluate(record, normalized, earthMoonSeries);
+	State moon = evaluate(record, normalized, moonSeries);
+	double earthShare = 1.0 / (1.0 + header.earthMoonRatio);
+	State earth = { barycenter.position - moon.position * earthShare, barycenter.velocity - moon.velocity * earthShare };
+	if (body == Body::Earth) {
+		return earth;
+	}
+	return { earth.position + moon.position, earth.velocity + moon.velocity };
+}
+
+
+void Ephemeris::allStates(double jd, State states[bodyCount]) const {
+	double normalized;
+	const double* record = locate(jd, normalized);
+	for (uint32_t s = 0; s < EphemerisFile::seriesCount; s++) {
+		states[s] = evaluate(record, normalized, s);
+	}
+
+	State& earth = states[int(Body::Earth)];
+	State& moon = states[int(Body::Moon)];
+	double earthShare = 1.0 / (1.0 + header.earthMoonRatio);
+	earth.position = states[earthMoonSeries].position - moon.position * earthShare;
+	earth.velocity = states[earthMoonSeries].velocity - moon.velocity * earthShare;
+	moon.position += earth.position;
+	moon.velocity += earth.velocity;
+}
+
+
+glm::dvec3 Ephemeris::heliocentricEcliptic(Body body, double jd) const {
+	return toEcliptic(state(body, jd).position - state(Body::Sun, jd).position);
+}
+
+
+void Ephemeris::allHeliocentricEcliptic(double jd, glm::dvec3 positions[bodyCount]) const {
+	State states[bodyCount];
+	allStates(jd, states);
+	for (int i = 0; i < bodyCount; i++) {
+		positions[i] = toEcliptic(states[i].position - states[int(Body::Sun)].position);
+	}
+}
+
+
+// Kilometres on ICRF axes to AU on J2000 ecliptic axes
+glm::dvec3 Ephemeris::toEcliptic(const glm::dvec3& position) const {
+	return Frames::equatorialToEcliptic(position / header.au);
+}
+
+
+bool Ephemeris::bodyFromName(const std::string& name, Body& body) {
+	auto found = std::find(std::begin(names), std::end(names), name);
+	if (found == std::end(names)) {
+		return false;
+	}
+	body = Body(found - std::begin(names));
+	return true;
+}
+
+
+int Ephemeris::naifId(Body body) {
+	return naifIds[int(body)];
+}
+
+
+bool Ephemeris::bodyFromNaifId(int id, Body& body) {
+	auto found = std::find(std::begin(naifIds), std::end(naifIds), id);
+	if (found == std::end(naifIds)) {
+		return false;
+	}
+	body = Body(found - std::begin(naifIds));
+	return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a reader for Chebyshev ephemerides (see EphemerisFile.h).
+//
+// The file is memory mapped and evaluated in place. Finding the coefficients
+// for an epoch is arithmetic on the fixed record size, and positions and
+// velocities come from one Clenshaw recurrence over x, y and z together.
+// allStates shares the record lookup between every body, which is how the
+// scene asks for them each frame.
+//------------------------------------------------------------------------------
+
+#include "EphemerisFile.h"
+#include "MappedFile.h"
+
+#include <glm/glm.hpp>
+
+#include <string>
+
+
+class Ephemeris {
+
+public:
+	// The stored series first, in DE order, then those derived from them
+	enum class Body {
+		Mercury, Venus, EarthMoonBarycenter, Mars, Jupiter, Saturn, Uranus, Neptune, Pluto,
+		Moon, Sun, Earth,
+	};
+	static constexpr int bodyCount = 12;
+
+	// Kilometres and kilometres per day, barycentric, ICRF axes
+	struct State {
+		glm::dvec3 position;
+		glm::dvec3 velocity;
+	};
+
+	// Throws if the file is missing or isn't a converted ephemeris
+	explicit Ephemeris(const std::string& path);
+
+	// Public interface
+	double startJD() const { return header.startJD; }
+	double endJD() const { return header.startJD + header.intervalDays * header.recordCount; }
+	bool covers(double jd) const { return jd >= startJD() && jd <= endJD(); }
+	double au() const { return header.au; }
+
+	// Throws outside the covered span
+	State state(Body body, double jd) const;
+
+	// Every body at once, indexed by Body
+	void allStates(double jd, State states[bodyCount]) const;
+
+	// Heliocentric position in AU, rotated into the J2000 ecliptic the scene
+	// is drawn in
+	glm::dvec3 heliocentricEcliptic(Body body, double jd) const;
+	void allHeliocentricEcliptic(double jd, glm::dvec3 positions[bodyCount]) const;
+
+	// Lower case names, "earth", "moon"...; false if there is no such body
+	static bool bodyFromName(const std::string& name, Body& body);
+
+	// The NAIF id SPK kernels use for the body; the planets' series are
+	// their barycentres
+	static int naifId(Body body);
+
+	// The reverse; false for ids with no series
+	static bool bodyFromNaifId(int id, Body& body);
+
+private:
+	MappedFile file;
+	EphemerisFile::Header header;
+	const EphemerisFile::Series* series;
+	const double* records;
+
+	const double* locate(double jd, double& normalized) const;
+	State evaluate(const double* record, double normalized, uint32_t index) const;
+	glm::dvec3 toEcliptic(const glm::dvec3& position) const;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file describes the binary Chebyshev ephemeris format.
+//
+// It holds the position series of a JPL DE ephemeris (DE405, DE430, DE440...)
+// reorganised so it can be memory mapped and evaluated in place. It is written
+// by tools/ephconv from the ASCII distribution and read by Ephemeris.
+//
+// After the header and the body table come recordCount fixed-size records,
+// each covering intervalDays from startJD + index * intervalDays. Within a
+// record every body has subintervals equal spans, and each span stores its
+// Chebyshev coefficients interleaved as x0 y0 z0 x1 y1 z1 ..., so one step
+// of the recurrence reads three neighbouring doubles.
+//
+// Units are as in the source: kilometres, ICRF axes, Julian dates in TDB.
+// The planets and the Sun are relative to the solar system barycentre, the
+// Moon to the Earth.
+//------------------------------------------------------------------------------
+
+#include <cstdint>
+
+
+namespace EphemerisFile {
+
+	const char magic[4] = { 'O', 'E', 'P', 'H' };
+	const uint32_t version = 1;
+
+	// The position series of a DE file, in the order of its pointer table
+	const uint32_t seriesCount = 11;
+
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint32_t seriesCount;
+		uint32_t recordCount;
+		uint32_t recordDoubles;		// size of one record
+		uint32_t denumber;			// 440 for DE440, from the source header
+		double startJD;
+		double intervalDays;
+		double au;					// kilometres per astronomical unit
+		double earthMoonRatio;		// Earth mass over Moon mass
+	};
+
+	struct Series {
+		uint32_t offset;			// doubles from the start of a record
+		uint32_t coefficients;		// per component
+		uint32_t subintervals;
+		uint32_t padding;
+	};
+
+	static_assert(sizeof(Header) == 56, "EphemerisFile::Header must be packed");
+	static_assert(sizeof(Series) == 16, "EphemerisFile::Series must be packed");
+}
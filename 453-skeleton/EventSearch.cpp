@@ -0,0 +1,366 @@
+#include "EventSearch.h"
+
+#include "Frames.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+
+namespace {
+
+	// Intervals per run
+	const size_t runIntervals = 256;
+
+	// Roots are refined to a tenth of a second; those closer than this are
+	// the same root found from both sides of a sample
+	const double tolerance = 1e-6;
+	const double duplicateWindow = 1e-4;
+
+	// NAIF ids
+	const int sun = 10;
+	const int earth = 399;
+	const int moon = 301;
+
+	// Kilometres
+	const double sunRadius = 696000.0;
+	const double earthRadius = 6378.137;
+	const double moonRadius = 1737.4;
+
+	// The atmosphere widens the Earth's shadow by about a fiftieth
+	const double shadowEnlargement = 1.02;
+
+	const double notANumber = std::numeric_limits<double>::quiet_NaN();
+
+	// Brent's method on [a, b], where f(a) and f(b) have opposite signs:
+	// inverse quadratic or secant steps while they converge, bisection when
+	// they don't
+	double brent(const std::function<double(double)>& f, double a, double b, double fa, double fb) {
+		double c = b, fc = fb;
+		double d = 0.0, e = 0.0;
+		for (int iteration = 0; iteration < 100; iteration++) {
+			if ((fb > 0.0) == (fc > 0.0)) {
+				c = a;
+				fc = fa;
+				d = e = b - a;
+			}
+			if (std::abs(fc) < std::abs(fb)) {
+				a = b;
+				b = c;
+				c = a;
+				fa = fb;
+				fb = fc;
+				fc = fa;
+			}
+
+			double limit = 2.0 * std::numeric_limits<double>::epsilon() * std::abs(b) + 0.5 * tolerance;
+			double middle = 0.5 * (c - b);
+			if (std::abs(middle) <= limit || fb == 0.0) {
+				return b;
+			}
+
+			if (std::abs(e) >= limit && std::abs(fa) > std::abs(fb)) {
+				double s = fb / fa;
+				double p, q;
+				if (a == c) {
+					p = 2.0 * middle * s;
+					q = 1.0 - s;
+				}
+				else {
+					double r = fb / fc;
+					q = fa / fc;
+					p = s * (2.0 * middle * q * (q - r) - (b - a) * (r - 1.0));
+					q = (q - 1.0) * (r - 1.0) * (s - 1.0);
+				}
+				if (p > 0.0) {
+					q = -q;
+				}
+				p = std::abs(p);
+				if (2.0 * p < std::min(3.0 * middle * q - std::abs(limit * q), std::abs(e * q))) {
+					e = d;
+					d = p / q;
+				}
+				else {
+					d = e = middle;
+				}
+			}
+			else {
+				d = e = middle;
+			}
+
+			a = b;
+			fa = fb;
+			b += std::abs(d) > limit ? d : std::copysign(limit, middle);
+			fb = f(b);
+			if (std::isnan(fb)) {
+				return a;
+			}
+		}
+		return b;
+	}
+
+	// The part of v across the unit axis
+	glm::dvec3 across(const glm::dvec3& v, const glm::dvec3& axis) {
+		return v - glm::dot(v, axis) * axis;
+	}
+
+	// sin of the difference in ecliptic longitude of two directions
+	double longitudeSine(const glm::dvec3& a, const glm::dvec3& b) {
+		return (a.y * b.x - a.x * b.y) / (glm::length(glm::dvec2(a)) * glm::length(glm::dvec2(b)));
+	}
+
+	double latitude(const glm::dvec3& v) {
+		return std::atan2(v.z, glm::length(glm::dvec2(v)));
+	}
+}
+
+
+EventSearch::EventSearch(const StateQuery& query, unsigned threadCount)
+	: query(query)
+	, threadCount(threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency()))
+{}
+
+
+std::vector<EventSearch::Root> EventSearch::roots(const std::function<double(double)>& f, double start, double end, double step) const {
+	if (!(end > start) || !(step > 0.0)) {
+		return {};
+	}
+
+	// Steps fitted to the span, so the last sample lands on its end
+	const size_t intervals = size_t(std::ceil((end - start) / step));
+	const double h = (end - start) / double(intervals);
+	const size_t runCount = (intervals + runIntervals - 1) / runIntervals;
+
+	std::vector<std::vector<Root>> found(runCount);
+	std::atomic<size_t> next{ 0 };
+	auto work = [&]() {
+		std::vector<double> samples;
+		for (size_t run = next++; run < runCount; run = next++) {
+			size_t first = run * runIntervals;
+			size_t last = std::min(first + runIntervals, intervals);
+			samples.resize(last - first + 1);
+			for (size_t i = first; i <= last; i++) {
+				samples[i - first] = f(i == intervals ? end : start + h * double(i));
+			}
+
+			// A zero counts as positive, so a root on a shared sample
+			// belongs to one interval only
+			for (size_t i = first; i < last; i++) {
+				double fa = samples[i - first];
+				double fb = samples[i - first + 1];
+				if (std::isnan(fa) || std::isnan(fb) || (fa < 0.0) == (fb < 0.0)) {
+					continue;
+				}
+				double a = start + h * double(i);
+				double b = i + 1 == intervals ? end : start + h * double(i + 1);
+				found[run].push_back({ brent(f, a, b, fa, fb), fa < 0.0 });
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < std::min<size_t>(threadCount, runCount); i++) {
+		threads.emplace_back(work);
+	}
+	work();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	// Runs are in order and so are their roots; refinement can still pull
+	// neighbours past each other or onto the same time
+	std::vector<Root> merged;
+	for (const std::vector<Root>& roots : found) {
+		merged.insert(merged.end(), roots.begin(), roots.end());
+	}
+	std::sort(merged.begin(), merged.end(), [](const Root& a, const Root& b) { return a.julianDate < b.julianDate; });
+	merged.erase(std::unique(merged.begin(), merged.end(), [](const Root& a, const Root& b) {
+		return a.rising == b.rising && b.julianDate - a.julianDate < duplicateWindow;
+	}), merged.end());
+	return merged;
+}
+
+
+std::vector<EventSearch::Event> EventSearch::conjunctions(int a, int b, int observer, double start, double end, bool oppositions, double step) const {
+	auto directions = [&](double jd, glm::dvec3& first, glm::dvec3& second) {
+		StateQuery::State sa, sb;
+		if (!query.state(a, observer, jd, sa) || !query.state(b, observer, jd, sb)) {
+			return false;
+		}
+		first = Frames::equatorialToEcliptic(sa.position);
+		second = Frames::equatorialToEcliptic(sb.position);
+		return true;
+	};
+
+	std::vector<Event> events;
+	for (const Root& root : roots([&](double jd) {
+		glm::dvec3 first, second;
+		return directions(jd, first, second) ? longitudeSine(first, second) : notANumber;
+	}, start, end, step)) {
+		glm::dvec3 first, second;
+		if (!directions(root.julianDate, first, second)) {
+			continue;
+		}
+		bool opposite = glm::dot(glm::dvec2(first), glm::dvec2(second)) < 0.0;
+		if (opposite && !oppositions) {
+			continue;
+		}
+		Kind kind = opposite ? Kind::Opposition : Kind::Conjunction;
+		double separation = opposite ? latitude(first) + latitude(second) : latitude(first) - latitude(second);
+		events.push_back({ kind, root.julianDate, { a, b }, Eclipse::None, separation });
+	}
+	return events;
+}
+
+
+std::vector<EventSearch::Event> EventSearch::closeApproaches(int a, int b, double threshold, double start, double end, double step) const {
+	// The range rate goes from closing to opening at each least distance
+	std::vector<Event> events;
+	for (const Root& root : roots([&](double jd) {
+		StateQuery::State state;
+		return query.state(a, b, jd, state) ? glm::dot(state.position, state.velocity) : notANumber;
+	}, start, end, step)) {
+		StateQuery::State state;
+		if (root.rising && query.state(a, b, root.julianDate, state) && glm::length(state.position) < threshold) {
+			events.push_back({ Kind::CloseApproach, root.julianDate, { a, b }, Eclipse::None, glm::length(state.position) });
+		}
+	}
+	return events;
+}
+
+
+std::vector<EventSearch::Event> EventSearch::eclipses(double start, double end) const {
+	// New and full moons; the Moon moves a good 12 degrees a day from the Sun
+	std::vector<Event> syzygies = conjunctions(moon, sun, earth, start, end, true, 1.0);
+
+	std::vector<Event> events;
+	for (const Event& syzygy : syzygies) {
+		Event event;
+		bool found = syzygy.kind == Kind::Opposition ? lunarEclipse(syzygy.julianDate, event) : solarEclipse(syzygy.julianDate, event);
+		if (found && event.julianDate >= start && event.julianDate <= end) {
+			events.push_back(event);
+		}
+	}
+	return events;
+}
+
+
+// The Sun's motion over the hours between the full moon and the greatest
+// eclipse is small enough to leave out of the shadow axis' rate
+bool EventSearch::lunarEclipse(double fullMoon, Event& event) const {
+	auto geometry = [&](double jd, glm::dvec3& offset, glm::dvec3& rate, double& along, double& sunDistance) {
+		StateQuery::State lunar, solar;
+		if (!query.state(moon, earth, jd, lunar) || !query.state(sun, earth, jd, solar)) {
+			return false;
+		}
+		sunDistance = glm::length(solar.position);
+		glm::dvec3 axis = -solar.position / sunDistance;
+		along = glm::dot(lunar.position, axis);
+		offset = across(lunar.position, axis);
+		rate = across(lunar.velocity, axis);
+		return true;
+	};
+	auto closing = [&](double jd) {
+		glm::dvec3 offset, rate;
+		double along, sunDistance;
+		return geometry(jd, offset, rate, along, sunDistance) ? glm::dot(offset, rate) : notANumber;
+	};
+
+	double greatest = fullMoon;
+	double before = closing(fullMoon - 0.5), after = closing(fullMoon + 0.5);
+	if (before < 0.0 && after >= 0.0) {
+		greatest = brent(closing, fullMoon - 0.5, fullMoon + 0.5, before, after);
+	}
+
+	glm::dvec3 offset, rate;
+	double along, sunDistance;
+	if (!geometry(greatest, offset, rate, along, sunDistance)) {
+		return false;
+	}
+	double umbra = shadowEnlargement * (earthRadius - along * (sunRadius - earthRadius) / sunDistance);
+	double penumbra = shadowEnlargement * (earthRadius + along * (sunRadius + earthRadius) / sunDistance);
+	double miss = glm::length(offset);
+	if (miss - moonRadius >= penumbra) {
+		return false;
+	}
+
+	double magnitude = (umbra + moonRadius - miss) / (2.0 * moonRadius);
+	Eclipse eclipse = magnitude >= 1.0 ? Eclipse::Total : magnitude > 0.0 ? Eclipse::Partial : Eclipse::Penumbral;
+	event = { Kind::LunarEclipse, greatest, { moon, earth }, eclipse, magnitude };
+	return true;
+}
+
+
+bool EventSearch::solarEclipse(double newMoon, Event& event) const {
+	// The Moon's shadow axis runs from the Sun through the Moon; the Earth
+	// is offset from it by minus the Moon's geocentric position
+	auto geometry = [&](double jd, glm::dvec3& offset, glm::dvec3& rate, double& along, double& sunDistance) {
+		StateQuery::State lunar, solar;
+		if (!query.state(moon, earth, jd, lunar) || !query.state(sun, earth, jd, solar)) {
+			return false;
+		}
+		glm::dvec3 shadow = lunar.position - solar.position;
+		sunDistance = glm::length(shadow);
+		glm::dvec3 axis = shadow / sunDistance;
+		along = glm::dot(-lunar.position, axis);
+		offset = across(-lunar.position, axis);
+		rate = across(-lunar.velocity, axis);
+		return true;
+	};
+	auto closing = [&](double jd) {
+		glm::dvec3 offset, rate;
+		double along, sunDistance;
+		return geometry(jd, offset, rate, along, sunDistance) ? glm::dot(offset, rate) : notANumber;
+	};
+
+	double greatest = newMoon;
+	double before = closing(newMoon - 0.5), after = closing(newMoon + 0.5);
+	if (before < 0.0 && after >= 0.0) {
+		greatest = brent(closing, newMoon - 0.5, newMoon + 0.5, before, after);
+	}
+
+	glm::dvec3 offset, rate;
+	double along, sunDistance;
+	if (!geometry(greatest, offset, rate, along, sunDistance)) {
+		return false;
+	}
+
+	// Past the umbra's tip its radius goes negative: the antumbra, where the
+	// eclipse is annular
+	double umbra = moonRadius - along * (sunRadius - moonRadius) / sunDistance;
+	double penumbra = moonRadius + along * (sunRadius + moonRadius) / sunDistance;
+	double miss = glm::length(offset);
+	if (miss >= earthRadius + penumbra) {
+		return false;
+	}
+
+	Eclipse eclipse = miss >= earthRadius ? Eclipse::Partial : umbra > 0.0 ? Eclipse::Total : Eclipse::Annular;
+	event = { Kind::SolarEclipse, greatest, { moon, earth }, eclipse, miss / earthRadius };
+	return true;
+}
+
+
+const char* EventSearch::kindName(Kind kind) {
+	switch (kind) {
+	case Kind::Conjunction: return "conjunction";
+	case Kind::Opposition: return "opposition";
+	case Kind::CloseApproach: return "close approach";
+	case Kind::LunarEclipse: return "lunar eclipse";
+	case Kind::SolarEclipse: return "solar eclipse";
+	}
+	return "";
+}
+
+
+const char* EventSearch::eclipseName(Eclipse eclipse) {
+	switch (eclipse) {
+	case Eclipse::None: return "";
+	case Eclipse::Penumbral: return "penumbral";
+	case Eclipse::Partial: return "partial";
+	case Eclipse::Total: return "total";
+	case Eclipse::Annular: return "annular";
+	}
+	return "";
+}
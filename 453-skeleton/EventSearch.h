@@ -0,0 +1,82 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a search for eclipses, conjunctions and close approaches.
+//
+// Each kind of event is the root of a smooth function of time: the sine of
+// the difference in ecliptic longitude for conjunctions and oppositions (and
+// so new and full moons), the range rate for close approaches. The span is
+// sampled every step days in runs that threads take from a shared counter,
+// each sign change is refined with Brent's method, and the roots of every run
+// are merged in order. Runs share their end samples; a root is credited to
+// the interval it falls in, and any found twice are merged.
+//
+// Eclipses are checked at every new and full moon: the greatest eclipse is
+// where the Moon passes closest to the Earth's shadow axis (or its own shadow
+// axis passes closest to the Earth), and the shadow cones there say what kind
+// it is. Positions are geometric; light time and aberration, which move
+// events by a minute or so, are left out. The step must be short enough that
+// no two roots fall between samples; a day suits anything in the solar
+// system but close flybys.
+//------------------------------------------------------------------------------
+
+#include "StateQuery.h"
+
+#include <functional>
+#include <vector>
+
+
+class EventSearch {
+
+public:
+	enum class Kind { Conjunction, Opposition, CloseApproach, LunarEclipse, SolarEclipse };
+
+	// Penumbral only applies to the Moon, Annular only to the Sun
+	enum class Eclipse { None, Penumbral, Partial, Total, Annular };
+
+	struct Event {
+		Kind kind;
+		double julianDate;	// TDB
+		int bodies[2];
+		Eclipse eclipse;
+
+		// Conjunctions: the difference in ecliptic latitude (radians).
+		// Close approaches: the distance (km). Lunar eclipses: the umbral
+		// magnitude, negative when only the penumbra is reached. Solar
+		// eclipses: gamma, the shadow axis' least distance from the Earth's
+		// centre in Earth radii.
+		double value;
+	};
+
+	// threadCount 0 uses one thread per core
+	explicit EventSearch(const StateQuery& query, unsigned threadCount = 0);
+
+	// Public interface
+	// Every lunar and solar eclipse in [start, end], Julian dates
+	std::vector<Event> eclipses(double start, double end) const;
+
+	// When a and b have the same ecliptic longitude as seen from observer,
+	// and, with oppositions, when they are half a turn apart
+	std::vector<Event> conjunctions(int a, int b, int observer, double start, double end, bool oppositions = false, double step = 1.0) const;
+
+	// Least distances between a and b closer than threshold kilometres
+	std::vector<Event> closeApproaches(int a, int b, double threshold, double start, double end, double step = 1.0) const;
+
+	static const char* kindName(Kind kind);
+	static const char* eclipseName(Eclipse eclipse);
+
+private:
+	struct Root {
+		double julianDate;
+		bool rising;	// from negative to positive
+	};
+
+	const StateQuery& query;
+	unsigned threadCount;
+
+	// NaN where the sources have no data; those intervals are skipped
+	std::vector<Root> roots(const std::function<double(double)>& f, double start, double end, double step) const;
+
+	bool lunarEclipse(double fullMoon, Event& event) const;
+	bool solarEclipse(double newMoon, Event& event) const;
+};
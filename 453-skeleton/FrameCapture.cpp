@@ -0,0 +1,252 @@
+#include "FrameCapture.h"
+
+#include "GLState.h"
+#include "Log.h"
+#include "Profiler.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+
+namespace {
+	// Frames waiting for a worker, per worker, before capture() blocks
+	const size_t queuedPerWorker = 2;
+}
+
+
+FrameCapture::FrameCapture(const std::string& directory, Format format, int slotCount, int workerCount)
+	: directory(directory)
+	, format(format)
+	, slots(slotCount)
+	, next(0)
+	, frame(0)
+	, busy(0)
+	, stopping(false)
+	, written(0)
+	, failed(0)
+{
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error) {
+		Log::error("FRAME_CAPTURE unable to create {}: {}", directory, error.message());
+		throw std::runtime_error("Failed to create capture directory.");
+	}
+
+	if (workerCount <= 0) {
+		workerCount = std::max(1, int(std::thread::hardware_concurrency()) - 1);
+	}
+	maxQueued = queuedPerWorker * workerCount;
+
+	for (int i = 0; i < workerCount; i++) {
+		workers.emplace_back(&FrameCapture::work, this, i);
+	}
+	Log::info("FRAME_CAPTURE writing to {} with {} workers", directory, workerCount);
+}
+
+
+FrameCapture::~FrameCapture() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	jobReady.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	for (Slot& slot : slots) {
+		glDeleteSync(slot.fence);
+	}
+}
+
+
+void FrameCapture::capture(const Framebuffer& framebuffer) {
+	PROFILE_ZONE("capture");
+
+	// This slot was filled slotCount frames ago; hand it off before reuse
+	Slot& slot = slots[next];
+	if (slot.fence != nullptr) {
+		retire(slot);
+	}
+
+	glm::ivec2 size = framebuffer.getDimensions();
+	GLsizeiptr bytes = GLsizeiptr(size.x) * size.y * 4;
+
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	if (bytes > slot.capacity) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+		slot.capacity = bytes;
+	}
+
+	// With a pack buffer bound this only queues the copy
+	framebuffer.bind();
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	framebuffer.unbind();
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.frame = frame++;
+	slot.size = size;
+	next = (next + 1) % int(slots.size());
+}
+
+
+void FrameCapture::finish() {
+	// Oldest first, so frames reach the workers in order
+	for (size_t i = 0; i < slots.size(); i++) {
+		Slot& slot = slots[(next + i) % slots.size()];
+		if (slot.fence != nullptr) {
+			retire(slot);
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	jobDone.wait(lock, [this]() { return jobs.empty() && busy == 0; });
+	Log::info("FRAME_CAPTURE wrote {} frames to {} ({} failed)", written, directory, failed);
+}
+
+
+unsigned long long FrameCapture::getWritten() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return written;
+}
+
+
+unsigned long long FrameCapture::getFailed() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return failed;
+}
+
+
+FrameCapture::Format FrameCapture::parseFormat(const std::string& name) {
+	if (name == "png") {
+		return Format::PNG;
+	}
+	if (name == "raw") {
+		return Format::Raw;
+	}
+	Log::error("FRAME_CAPTURE unknown format {}, expected png or raw", name);
+	throw std::runtime_error("Unknown capture format.");
+}
+
+
+void FrameCapture::retire(Slot& slot) {
+	// The copy was queued slotCount frames ago, so this rarely waits
+	GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	while (status == GL_TIMEOUT_EXPIRED) {
+		PROFILE_ZONE("capture wait");
+		status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+	}
+	glDeleteSync(slot.fence);
+	slot.fence = nullptr;
+
+	Job job{ slot.frame, slot.size, {} };
+	size_t bytes = size_t(slot.size.x) * slot.size.y * 4;
+
+	// Wait for room in the queue, and reuse storage a worker has finished with
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (jobs.size() >= maxQueued) {
+			PROFILE_ZONE("capture backpressure");
+			jobDone.wait(lock, [this]() { return jobs.size() < maxQueued; });
+		}
+		if (!spare.empty()) {
+			job.pixels = std::move(spare.back());
+			spare.pop_back();
+		}
+	}
+	job.pixels.resize(bytes);
+
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(bytes), GL_MAP_READ_BIT);
+	if (mapped != nullptr) {
+		std::memcpy(job.pixels.data(), mapped, bytes);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (mapped == nullptr) {
+		Log::error("FRAME_CAPTURE unable to map frame {}", job.frame);
+		failed++;
+		return;
+	}
+	jobs.push_back(std::move(job));
+	jobReady.notify_one();
+}
+
+
+void FrameCapture::work(int index) {
+	Profiler::setThreadName(fmt::format("capture {}", index));
+
+	// Scratch for the flipped image, kept across frames
+	std::vector<unsigned char> flipped;
+
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobReady.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (jobs.empty()) {
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+			busy++;
+		}
+		jobDone.notify_all();
+
+		bool ok;
+		{
+			PROFILE_ZONE("encode");
+			ok = encode(job, flipped);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busy--;
+			if (ok) {
+				written++;
+			}
+			else {
+				failed++;
+			}
+			spare.push_back(std::move(job.pixels));
+		}
+		jobDone.notify_all();
+	}
+}
+
+
+bool FrameCapture::encode(const Job& job, std::vector<unsigned char>& flipped) const {
+	// GL rows start at the bottom, image files at the top
+	size_t stride = size_t(job.size.x) * 4;
+	flipped.resize(job.pixels.size());
+	for (int y = 0; y < job.size.y; y++) {
+		std::memcpy(&flipped[y * stride], &job.pixels[(job.size.y - 1 - y) * stride], stride);
+	}
+
+	std::string path = fmt::format("{}/frame_{:06d}.{}", directory, job.frame, format == Format::PNG ? "png" : "rgba");
+	bool ok;
+	if (format == Format::PNG) {
+		ok = stbi_write_png(path.c_str(), job.size.x, job.size.y, 4, flipped.data(), int(stride)) != 0;
+	}
+	else {
+		std::ofstream out(path, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(flipped.data()), std::streamsize(flipped.size()));
+		ok = bool(out);
+	}
+
+	if (!ok) {
+		Log::error("FRAME_CAPTURE unable to write {}", path);
+	}
+	return ok;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains an image sequence exporter for rendered frames.
+//
+// Frames are read back with glReadPixels into a ring of pixel buffer objects,
+// which returns immediately. Each buffer is only mapped when the ring comes
+// around to it again a few frames later, so the copy has long finished and
+// mapping doesn't stall. The pixels are then handed to a pool of worker
+// threads that flip and encode them to disk.
+//
+// If the workers fall behind, capture() blocks rather than dropping frames;
+// an image sequence with holes is no use to anyone.
+//
+// Example:
+//		FrameCapture capture("frames", FrameCapture::Format::PNG);
+//		while (...) {
+//			... render into framebuffer ...
+//			capture.capture(framebuffer);
+//		}
+//		capture.finish();
+//------------------------------------------------------------------------------
+
+#include "Framebuffer.h"
+#include "GLHandles.h"
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+class FrameCapture {
+
+public:
+	enum class Format {
+		PNG,	// frame_000000.png
+		Raw,	// frame_000000.rgba, tightly packed top-down RGBA8
+	};
+
+	// workerCount 0 picks one less than the hardware threads (at least one)
+	FrameCapture(const std::string& directory, Format format, int slotCount = 3, int workerCount = 0);
+
+	// Owns threads and fences, so it can't be copied
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture operator=(const FrameCapture&) = delete;
+
+	~FrameCapture();
+
+	// Public interface
+	void capture(const Framebuffer& framebuffer);
+
+	// Reads back every pending frame and waits until all are on disk.
+	// Needs the GL context, so call it before the context goes away.
+	void finish();
+
+	unsigned long long getWritten() const;
+	unsigned long long getFailed() const;
+
+	static Format parseFormat(const std::string& name);
+
+private:
+	struct Slot {
+		VertexBufferHandle pbo;
+		GLsync fence = nullptr;
+		unsigned long long frame = 0;
+		glm::ivec2 size = glm::ivec2(0);
+		GLsizeiptr capacity = 0;
+	};
+
+	struct Job {
+		unsigned long long frame;
+		glm::ivec2 size;
+		std::vector<unsigned char> pixels;
+	};
+
+	std::string directory;
+	Format format;
+
+	std::vector<Slot> slots;
+	int next;
+	unsigned long long frame;
+
+	// Shared with the workers, guarded by mutex
+	mutable std::mutex mutex;
+	std::condition_variable jobReady;
+	std::condition_variable jobDone;
+	std::deque<Job> jobs;
+	std::vector<std::vector<unsigned char>> spare; // recycled pixel storage
+	size_t maxQueued;
+	int busy;
+	bool stopping;
+	unsigned long long written;
+	unsigned long long failed;
+
+	std::vector<std::thread> workers;
+
+	void retire(Slot& slot);
+	void work(int index);
+	bool encode(const Job& job, std::vector<unsigned char>& flipped) const;
+};
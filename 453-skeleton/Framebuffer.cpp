@@ -0,0 +1,65 @@
+#include "Framebuffer.h"
+
+#include "GLDebug.h"
+#include "Log.h"
+
+#include <stdexcept>
+
+
+Framebuffer::Framebuffer(int width, int height)
+	: fboID(), colorTexture(), depthTexture(), width(width), height(height)
+{
+	allocate();
+	GLDebug::label(GL_FRAMEBUFFER, fboID, "scene");
+	GLDebug::label(GL_TEXTURE, colorTexture, "scene colour");
+	GLDebug::label(GL_TEXTURE, depthTexture, "scene depth");
+}
+
+
+void Framebuffer::resize(int width_, int height_) {
+	if (width_ == width && height_ == height) {
+		return;
+	}
+	width = width_;
+	height = height_;
+	allocate();
+}
+
+
+void Framebuffer::blitToDefault(int windowWidth, int windowHeight) const {
+	GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, fboID);
+	GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+
+void Framebuffer::allocate() {
+	// Zero sized windows (e.g. minimized) can't have attachments
+	int w = width > 0 ? width : 1;
+	int h = height > 0 ? height : 1;
+
+	// sRGB colour so GL_FRAMEBUFFER_SRGB behaves as it does for the window
+	GLState::bindTexture(0, GL_TEXTURE_2D, colorTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	GLState::bindTexture(0, GL_TEXTURE_2D, depthTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, w, h, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+
+	bind();
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	unbind();
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		Log::error("FRAMEBUFFER incomplete ({:#x}) at {}x{}", status, w, h);
+		throw std::runtime_error("Framebuffer is incomplete.");
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains the offscreen render target the scene is drawn into.
+//
+// The default framebuffer only offers fixed-point depth, which runs out of
+// precision long before real solar-system distances. Rendering into our own
+// framebuffer lets us attach a 32-bit floating point depth buffer; the colour
+// is then blitted to the window.
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+#include "GLState.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+
+class Framebuffer {
+
+public:
+	Framebuffer(int width, int height);
+
+	// Because we're using the Framebuffer- and TextureHandles to do RAII for us
+	// and our other types are trivial or provide their own RAII
+	// we don't have to provide any specialized functions here. Rule of zero
+	//
+	// https://en.cppreference.com/w/cpp/language/rule_of_three
+	// https://github.com/isocpp/CppCoreGuidelines/blob/master/CppCoreGuidelines.md#Rc-zero
+
+	// Public interface
+	void bind() const { GLState::bindFramebuffer(GL_FRAMEBUFFER, fboID); }
+	void unbind() const { GLState::bindFramebuffer(GL_FRAMEBUFFER, 0); }
+
+	// Reallocates the attachments if the size changed
+	void resize(int width, int height);
+
+	// Copies the colour attachment into the window's framebuffer
+	void blitToDefault(int width, int height) const;
+
+	glm::ivec2 getDimensions() const { return glm::ivec2(width, height); }
+	GLuint getColorTexture() const { return colorTexture; }
+
+private:
+	FramebufferHandle fboID;
+	TextureHandle colorTexture;
+	TextureHandle depthTexture;
+
+	int width;
+	int height;
+
+	void allocate();
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Reference frame and time constants shared by the ephemeris readers.
+//
+// Ephemerides come on ICRF (J2000 equatorial) axes; the scene, the star
+// catalog and the minor planet elements use the J2000 ecliptic, with the xy
+// plane as the reference plane. Julian dates are TDB throughout.
+//------------------------------------------------------------------------------
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+
+namespace Frames {
+
+	// Mean obliquity of the ecliptic at J2000, as tools/starconv uses
+	const double obliquity = 23.4392911 * 3.14159265358979323846 / 180.0;
+
+	// IAU 2012 definition, exact
+	const double auKilometres = 149597870.7;
+
+	const double j2000 = 2451545.0;
+	const double secondsPerDay = 86400.0;
+
+	inline glm::dvec3 equatorialToEcliptic(const glm::dvec3& v) {
+		double c = std::cos(obliquity), s = std::sin(obliquity);
+		return glm::dvec3(v.x, v.y * c + v.z * s, -v.y * s + v.z * c);
+	}
+
+	inline glm::dvec3 eclipticToEquatorial(const glm::dvec3& v) {
+		double c = std::cos(obliquity), s = std::sin(obliquity);
+		return glm::dvec3(v.x, v.y * c - v.z * s, v.y * s + v.z * c);
+	}
+
+	// Ephemeris time, as SPICE kernels count it
+	inline double secondsPastJ2000(double julianDate) {
+		return (julianDate - j2000) * secondsPerDay;
+	}
+
+	// Gregorian calendar date (Julian before 1582 October 15) and the hours
+	// into that day, after Meeus, Astronomical Algorithms ch. 7
+	inline void calendarDate(double julianDate, int& year, int& month, int& day, double& hours) {
+		double shifted = julianDate + 0.5;
+		double z = std::floor(shifted);
+		double a = z;
+		if (z >= 2299161.0) {
+			double alpha = std::floor((z - 1867216.25) / 36524.25);
+			a = z + 1.0 + alpha - std::floor(alpha / 4.0);
+		}
+		double b = a + 1524.0;
+		double c = std::floor((b - 122.1) / 365.25);
+		double d = std::floor(365.25 * c);
+		double e = std::floor((b - d) / 30.6001);
+		day = int(b - d - std::floor(30.6001 * e));
+		month = int(e < 14.0 ? e - 1.0 : e - 13.0);
+		year = int(month > 2 ? c - 4716.0 : c - 4715.0);
+		hours = (shifted - z) * 24.0;
+	}
+}
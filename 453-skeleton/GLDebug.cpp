@@ -1,81 +1,281 @@
 #include "GLDebug.h"
 #include "Log.h"
 
-#include <regex>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+namespace {
+
+	// Occurrences of one message logged in full before rate limiting
+	const uint64_t repeatLimit = 3;
+
+	struct Counters {
+		std::atomic<uint32_t> high{ 0 };
+		std::atomic<uint32_t> medium{ 0 };
+		std::atomic<uint32_t> low{ 0 };
+		std::atomic<uint32_t> notification{ 0 };
+		std::atomic<uint32_t> suppressed{ 0 };
+	};
+
+	struct Seen {
+		uint64_t count;
+		GLenum source;
+		GLenum type;
+		GLuint id;
+	};
+
+	// Asynchronous callbacks may arrive on driver threads, hence the lock
+	std::mutex seenMutex;
+	std::unordered_map<uint64_t, Seen> seen;
+	Counters frame;
+
+	bool enabled = false;
+	bool labels = false;
+	GLenum minimumSeverity = GL_DEBUG_SEVERITY_NOTIFICATION;
+	std::vector<GLenum> disabledSources;
+
+	const char* sourceName(GLenum source) {
+		switch (source) {
+			case GL_DEBUG_SOURCE_API:             return "API";
+			case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   return "Window System";
+			case GL_DEBUG_SOURCE_SHADER_COMPILER: return "Shader Compiler";
+			case GL_DEBUG_SOURCE_THIRD_PARTY:     return "Third Party";
+			case GL_DEBUG_SOURCE_APPLICATION:     return "Application";
+			case GL_DEBUG_SOURCE_OTHER:           return "Other";
+		}
+		return "Unknown";
+	}
+
+	const char* typeName(GLenum type) {
+		switch (type) {
+			case GL_DEBUG_TYPE_ERROR:               return "Error";
+			case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "Deprecated Behaviour";
+			case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "Undefined Behaviour";
+			case GL_DEBUG_TYPE_PORTABILITY:         return "Portability";
+			case GL_DEBUG_TYPE_PERFORMANCE:         return "Performance";
+			case GL_DEBUG_TYPE_MARKER:              return "Marker";
+			case GL_DEBUG_TYPE_PUSH_GROUP:          return "Push Group";
+			case GL_DEBUG_TYPE_POP_GROUP:           return "Pop Group";
+			case GL_DEBUG_TYPE_OTHER:               return "Other";
+		}
+		return "Unknown";
+	}
+
+	const char* severityName(GLenum severity) {
+		switch (severity) {
+			case GL_DEBUG_SEVERITY_HIGH:   return "high";
+			case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+			case GL_DEBUG_SEVERITY_LOW:    return "low";
+		}
+		return "notification";
+	}
+
+	Log::Level logLevel(GLenum severity) {
+		switch (severity) {
+			case GL_DEBUG_SEVERITY_HIGH:   return Log::Level::Error;
+			case GL_DEBUG_SEVERITY_MEDIUM: return Log::Level::Warn;
+			case GL_DEBUG_SEVERITY_LOW:    return Log::Level::Info;
+		}
+		return Log::Level::Debug;
+	}
+
+	// Lower is more severe, so filters can compare
+	int severityRank(GLenum severity) {
+		switch (severity) {
+			case GL_DEBUG_SEVERITY_HIGH:   return 0;
+			case GL_DEBUG_SEVERITY_MEDIUM: return 1;
+			case GL_DEBUG_SEVERITY_LOW:    return 2;
+		}
+		return 3;
+	}
+
+	// Drivers like to end messages with a newline
+	fmt::string_view trim(const GLchar* message, GLsizei length) {
+		const char* begin = message;
+		const char* end = message + (length >= 0 ? size_t(length) : std::char_traits<char>::length(message));
+		while (begin < end && std::isspace((unsigned char)*begin)) {
+			begin++;
+		}
+		while (end > begin && std::isspace((unsigned char)end[-1])) {
+			end--;
+		}
+		return fmt::string_view(begin, size_t(end - begin));
+	}
+
+	bool isPowerOfTwo(uint64_t n) {
+		return (n & (n - 1)) == 0;
+	}
+
+	// Later glDebugMessageControl calls override earlier ones, so the whole
+	// filter state is re-applied from scratch in a fixed order
+	void applyFilters() {
+		const GLenum severities[] = {
+			GL_DEBUG_SEVERITY_HIGH, GL_DEBUG_SEVERITY_MEDIUM, GL_DEBUG_SEVERITY_LOW, GL_DEBUG_SEVERITY_NOTIFICATION
+		};
+		for (GLenum severity : severities) {
+			GLboolean on = severityRank(severity) <= severityRank(minimumSeverity) ? GL_TRUE : GL_FALSE;
+			glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, severity, 0, nullptr, on);
+		}
+		for (GLenum source : disabledSources) {
+			glDebugMessageControl(source, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+		}
+
+		// profiler zones push a debug group each; don't echo them back every frame
+		glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+		glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+	}
+}
+
 
 void GLDebug::debugOutputHandler(
 	GLenum source,
 	GLenum type,
 	GLuint id,
 	GLenum severity,
-	GLsizei,
+	GLsizei length,
 	const GLchar *message,
 	const void *
 ) {
-    // ignore non-significant error/warning codes
-    //if(id == 131169 || id == 131185 || id == 131218 || id == 131204) return;
-
-    std::string sourceStr, typeStr, severityStr;
-
-    switch (source)
-    {
-        case GL_DEBUG_SOURCE_API:             sourceStr = "API"; break;
-        case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   sourceStr = "Window System"; break;
-        case GL_DEBUG_SOURCE_SHADER_COMPILER: sourceStr = "Shader Compiler"; break;
-        case GL_DEBUG_SOURCE_THIRD_PARTY:     sourceStr = "Third Party"; break;
-        case GL_DEBUG_SOURCE_APPLICATION:     sourceStr = "Application"; break;
-        case GL_DEBUG_SOURCE_OTHER:           sourceStr = "Other"; break;
-    }
-
-    switch (type)
-    {
-        case GL_DEBUG_TYPE_ERROR:               typeStr = "Error"; break;
-        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: typeStr = "Deprecated Behaviour"; break;
-        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  typeStr = "Undefined Behaviour"; break;
-        case GL_DEBUG_TYPE_PORTABILITY:         typeStr = "Portability"; break;
-        case GL_DEBUG_TYPE_PERFORMANCE:         typeStr = "Performance"; break;
-        case GL_DEBUG_TYPE_MARKER:              typeStr = "Marker"; break;
-        case GL_DEBUG_TYPE_PUSH_GROUP:          typeStr = "Push Group"; break;
-        case GL_DEBUG_TYPE_POP_GROUP:           typeStr = "Pop Group"; break;
-        case GL_DEBUG_TYPE_OTHER:               typeStr = "Other"; break;
-    }
-
-    std::string format = "[OPENGL] [{}] {} #{} -- {}: {}";
-    std::string message_str = message;
-    message_str = std::regex_replace(message_str, std::regex("^\\s+|\\s+$"), "$1");
-    switch (severity)
-    {
-        case GL_DEBUG_SEVERITY_HIGH:
-            severityStr = "high";
-			Log::error(format.c_str(), sourceStr, severityStr, id, typeStr, message_str);
-            break;
-        case GL_DEBUG_SEVERITY_MEDIUM:
-            severityStr = "medium";
-			Log::warn(format.c_str(), sourceStr, severityStr, id, typeStr, message_str);
-            break;
-        case GL_DEBUG_SEVERITY_LOW:
-            severityStr = "low";
-			Log::info(format.c_str(), sourceStr, severityStr, id, typeStr, message_str);
-            break;
-        case GL_DEBUG_SEVERITY_NOTIFICATION:
-			Log::debug(format.c_str(), sourceStr, severityStr, id, typeStr, message_str);
-            break;
-    }
+	switch (severity) {
+		case GL_DEBUG_SEVERITY_HIGH:   frame.high++; break;
+		case GL_DEBUG_SEVERITY_MEDIUM: frame.medium++; break;
+		case GL_DEBUG_SEVERITY_LOW:    frame.low++; break;
+		default:                       frame.notification++; break;
+	}
+
+	// Ids are only unique per source and type
+	uint64_t key = (uint64_t(source & 0xffff) << 48) | (uint64_t(type & 0xffff) << 32) | id;
+	uint64_t count;
+	{
+		std::lock_guard<std::mutex> lock(seenMutex);
+		Seen& entry = seen.emplace(key, Seen{ 0, source, type, id }).first->second;
+		count = ++entry.count;
+	}
+	if (count > repeatLimit && !isPowerOfTwo(count)) {
+		frame.suppressed++;
+		return;
+	}
+
+	// Same cut-off as the Log:: helpers, checked before formatting
+	Log::Level level = logLevel(severity);
+	if (int(level) < ORRERY_LOG_LEVEL) {
+		return;
+	}
+
+	std::string line = fmt::format("[OPENGL] [{}] {} #{} -- {}: {}",
+		sourceName(source), severityName(severity), id, typeName(type), trim(message, length));
+	if (count > repeatLimit) {
+		line += fmt::format(" (repeated {} times)", count);
+	}
+	Log::write(level, std::move(line));
 }
 
-void GLDebug::enable() {
+
+void GLDebug::enable(bool synchronous) {
 	GLint flags;
 	glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
 	if (flags & GL_CONTEXT_FLAG_DEBUG_BIT)
 	{
 		// initialize debug output
 		glEnable(GL_DEBUG_OUTPUT);
-		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+		if (synchronous) {
+			glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+		} else {
+			glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+		}
 		glDebugMessageCallback(GLDebug::debugOutputHandler, nullptr);
-		glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
-		Log::info("Enabling debug mode for opengl");
+		enabled = true;
+		applyFilters();
+		Log::info("Enabling debug mode for opengl ({})", synchronous ? "synchronous" : "asynchronous");
 	} else {
 		Log::warn("Unable to enable debug mode for opengl");
 	}
 }
 
+
+void GLDebug::setMinimumSeverity(GLenum severity) {
+	minimumSeverity = severity;
+	if (enabled) {
+		applyFilters();
+	}
+}
+
+
+void GLDebug::setSourceEnabled(GLenum source, bool on) {
+	disabledSources.erase(std::remove(disabledSources.begin(), disabledSources.end(), source), disabledSources.end());
+	if (!on) {
+		disabledSources.push_back(source);
+	}
+	if (enabled) {
+		applyFilters();
+	}
+}
+
+
+GLDebug::FrameStats GLDebug::nextFrame() {
+	FrameStats stats;
+	stats.high = frame.high.exchange(0);
+	stats.medium = frame.medium.exchange(0);
+	stats.low = frame.low.exchange(0);
+	stats.notification = frame.notification.exchange(0);
+	stats.suppressed = frame.suppressed.exchange(0);
+	return stats;
+}
+
+
+void GLDebug::logSummary(int maxEntries) {
+	std::vector<Seen> repeated;
+	{
+		std::lock_guard<std::mutex> lock(seenMutex);
+		for (const auto& entry : seen) {
+			if (entry.second.count > 1) {
+				repeated.push_back(entry.second);
+			}
+		}
+	}
+	if (repeated.empty()) {
+		return;
+	}
+
+	std::sort(repeated.begin(), repeated.end(), [](const Seen& a, const Seen& b) { return a.count > b.count; });
+	repeated.resize(std::min(repeated.size(), size_t(maxEntries)));
+	for (const Seen& entry : repeated) {
+		Log::info("[OPENGL] [{}] {} #{} seen {} times", sourceName(entry.source), typeName(entry.type), entry.id, entry.count);
+	}
+}
+
+
+void GLDebug::enableLabels() {
+	labels = GLEW_KHR_debug;
+	if (!labels) {
+		Log::info("KHR_debug unavailable, GL objects won't be labelled");
+	}
+}
+
+
+void GLDebug::label(GLenum identifier, GLuint name, const std::string& text) {
+	if (labels) {
+		glObjectLabel(identifier, name, GLsizei(text.size()), text.c_str());
+	}
+}
+
+
+GLDebug::Group::Group(const char* name, bool enabled)
+	: pushed(enabled)
+{
+	if (pushed) {
+		glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+	}
+}
+
+
+GLDebug::Group::~Group() {
+	if (pushed) {
+		glPopDebugGroup();
+	}
+}
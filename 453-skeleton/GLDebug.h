@@ -7,20 +7,74 @@
 //
 // We are going to use it (best we can) to give you advanced warning of when you
 // are doing something incorrectly.
+//
+// Messages are de-duplicated by source, type and id: the first few
+// occurrences are logged in full, after that only at every power of two
+// with a repeat count. Filters can be changed at any time and are applied by
+// the driver, so filtered messages cost nothing. Output is asynchronous
+// unless enable() is asked for synchronous mode, which makes the driver
+// report on the calling thread (useful in a debugger, slow otherwise).
 //------------------------------------------------------------------------------
 
+#include <cstdint>
+#include <string>
+
 
 namespace GLDebug {
 
+	// Messages received since the last nextFrame(), by severity
+	struct FrameStats {
+		uint32_t high = 0;
+		uint32_t medium = 0;
+		uint32_t low = 0;
+		uint32_t notification = 0;
+		uint32_t suppressed = 0;	// received but not logged, as repeats
+
+		uint32_t total() const { return high + medium + low + notification; }
+	};
+
 	void debugOutputHandler(
 		GLenum source,
 		GLenum type,
 		GLuint id,
 		GLenum severity,
-		GLsizei,
+		GLsizei length,
 		const GLchar *message,
 		const void *
 	);
 
-	void enable();
+	// Does nothing (but say so) if the context isn't a debug context
+	void enable(bool synchronous = false);
+
+	// Messages less severe than this are dropped by the driver.
+	// GL_DEBUG_SEVERITY_NOTIFICATION lets everything through (the default).
+	void setMinimumSeverity(GLenum severity);
+
+	// Turns all messages from one GL_DEBUG_SOURCE_* on or off
+	void setSourceEnabled(GLenum source, bool enabled);
+
+	// Returns the counts of the frame just finished and starts a new one
+	FrameStats nextFrame();
+
+	// Logs the ids that repeated the most, e.g. at shutdown
+	void logSummary(int maxEntries = 10);
+
+	// Object labels show up in debug messages and in RenderDoc/apitrace.
+	// label() does nothing until enableLabels(), so release runs skip it.
+	void enableLabels();
+	void label(GLenum identifier, GLuint name, const std::string& text);
+
+	// Pushes a debug group for the lifetime of the scope, so every push is
+	// popped however the scope is left. Does nothing unless enabled.
+	class Group {
+	public:
+		Group(const char* name, bool enabled);
+		~Group();
+
+		Group(const Group&) = delete;
+		Group operator=(const Group&) = delete;
+
+	private:
+		bool pushed;
+	};
 }
@@ -1,4 +1,5 @@
 #include "GLHandles.h"
+#include "GLState.h"
 
 #include <algorithm> // For std::swap
 
@@ -58,6 +59,9 @@ ShaderProgramHandle& ShaderProgramHandle::operator=(ShaderProgramHandle&& other)
 
 
 ShaderProgramHandle::~ShaderProgramHandle() {
+	if (programID != 0) {
+		GLState::forgetProgram(programID);
+	}
 	glDeleteProgram(programID);
 }
 
@@ -95,6 +99,9 @@ VertexArrayHandle& VertexArrayHandle::operator=(VertexArrayHandle&& other) noexc
 
 
 VertexArrayHandle::~VertexArrayHandle() {
+	if (vaoID != 0) {
+		GLState::forgetVertexArray(vaoID);
+	}
 	glDeleteVertexArrays(1, &vaoID);
 }
 
@@ -114,7 +121,12 @@ GLuint VertexArrayHandle::value() const {
 VertexBufferHandle::VertexBufferHandle()
 	: vboID(0) // Due to OpenGL syntax, we can't initial directly here, like we want.
 {
-	glGenBuffers(1, &vboID);
+	// DSA calls need a real object, which glGenBuffers only makes on first bind
+	if (GLState::hasDirectStateAccess()) {
+		glCreateBuffers(1, &vboID);
+	} else {
+		glGenBuffers(1, &vboID);
+	}
 }
 
 
@@ -132,6 +144,9 @@ VertexBufferHandle& VertexBufferHandle::operator=(VertexBufferHandle&& other) no
 
 
 VertexBufferHandle::~VertexBufferHandle() {
+	if (vboID != 0) {
+		GLState::forgetBuffer(vboID);
+	}
 	glDeleteBuffers(1, &vboID);
 }
 
@@ -148,10 +163,14 @@ GLuint VertexBufferHandle::value() const {
 
 //------------------------------------------------------------------------------
 
-TextureHandle::TextureHandle()
+TextureHandle::TextureHandle(GLenum target)
 	: textureID(0) // Due to OpenGL syntax, we can't initial directly here, like we want.
 {
-	glGenTextures(1, &textureID);
+	if (GLState::hasDirectStateAccess()) {
+		glCreateTextures(target, 1, &textureID);
+	} else {
+		glGenTextures(1, &textureID);
+	}
 }
 
 
@@ -168,6 +187,9 @@ TextureHandle& TextureHandle::operator=(TextureHandle&& other) noexcept {
 
 
 TextureHandle::~TextureHandle() {
+	if (textureID != 0) {
+		GLState::forgetTexture(textureID);
+	}
 	glDeleteTextures(1, &textureID);
 }
 
@@ -180,3 +202,42 @@ TextureHandle::operator GLuint() const {
 GLuint TextureHandle::value() const {
 	return textureID;
 }
+
+
+//------------------------------------------------------------------------------
+
+FramebufferHandle::FramebufferHandle()
+	: fboID(0) // Due to OpenGL syntax, we can't initial directly here, like we want.
+{
+	glGenFramebuffers(1, &fboID);
+}
+
+
+FramebufferHandle::FramebufferHandle(FramebufferHandle&& other) noexcept
+	: fboID(std::move(other.fboID))
+{
+	other.fboID = 0;
+}
+
+FramebufferHandle& FramebufferHandle::operator=(FramebufferHandle&& other) noexcept {
+	std::swap(fboID, other.fboID);
+	return *this;
+}
+
+
+FramebufferHandle::~FramebufferHandle() {
+	if (fboID != 0) {
+		GLState::forgetFramebuffer(fboID);
+	}
+	glDeleteFramebuffers(1, &fboID);
+}
+
+
+FramebufferHandle::operator GLuint() const {
+	return fboID;
+}
+
+
+GLuint FramebufferHandle::value() const {
+	return fboID;
+}
@@ -159,7 +159,8 @@ private:
 class TextureHandle {
 
 public:
-	TextureHandle();
+	// Under direct state access the texture is created for this target
+	explicit TextureHandle(GLenum target = GL_TEXTURE_2D);
 
 
 	// Disallow copying
@@ -182,3 +183,31 @@ private:
 	GLuint textureID;
 
 };
+
+
+// An RAII class for managing a Framebuffer GLuint for OpenGL.
+class FramebufferHandle {
+
+public:
+	FramebufferHandle();
+
+	// Disallow copying
+	FramebufferHandle(const FramebufferHandle&) = delete;
+	FramebufferHandle operator=(const FramebufferHandle&) = delete;
+
+	// Allow moving
+	FramebufferHandle(FramebufferHandle&& other) noexcept;
+	FramebufferHandle& operator=(FramebufferHandle&& other) noexcept;
+
+	// Clean up after ourselves.
+	~FramebufferHandle();
+
+	// Allow casting from this type into a GLuint
+	// This allows usage in situations where a function expects a GLuint
+	operator GLuint() const;
+	GLuint value() const;
+
+private:
+	GLuint fboID;
+
+};
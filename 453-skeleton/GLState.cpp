@@ -0,0 +1,345 @@
+#include "GLState.h"
+
+#include "Log.h"
+#include "RenderStats.h"
+
+#include <algorithm>
+#include <array>
+
+
+namespace {
+
+	// Marks state we know nothing about, so the next request always goes through
+	const GLuint unknown = ~GLuint(0);
+	const GLenum unknownEnum = ~GLenum(0);
+
+	const int maxCapabilities = 16;
+	const int maxTextureUnits = 16;
+
+	const GLenum bufferTargets[] = {
+		GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_PIXEL_PACK_BUFFER,
+		GL_PIXEL_UNPACK_BUFFER, GL_DRAW_INDIRECT_BUFFER, GL_DISPATCH_INDIRECT_BUFFER,
+		GL_SHADER_STORAGE_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+	};
+	const int bufferTargetCount = int(sizeof(bufferTargets) / sizeof(bufferTargets[0]));
+
+	const GLenum textureTargets[] = {
+		GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_3D, GL_TEXTURE_BUFFER,
+	};
+	const int textureTargetCount = int(sizeof(textureTargets) / sizeof(textureTargets[0]));
+
+	struct Capability {
+		GLenum name;
+		int enabled;	// -1 unknown
+	};
+
+	struct State {
+		bool directStateAccess = false;
+
+		std::array<Capability, maxCapabilities> capabilities;
+		int capabilityCount = 0;
+
+		GLenum depthFunc;
+		GLboolean depthMask;
+		GLenum blendSource;
+		GLenum blendDestination;
+
+		GLuint program;
+		GLuint vertexArray;
+		GLuint buffers[bufferTargetCount];
+		GLuint readFramebuffer;
+		GLuint drawFramebuffer;
+		GLuint activeUnit;
+		GLuint textures[maxTextureUnits][textureTargetCount];
+	};
+
+	State state;
+
+	int bufferSlot(GLenum target) {
+		for (int i = 0; i < bufferTargetCount; i++) {
+			if (bufferTargets[i] == target) {
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	int textureSlot(GLenum target) {
+		for (int i = 0; i < textureTargetCount; i++) {
+			if (textureTargets[i] == target) {
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	Capability* capability(GLenum name) {
+		for (int i = 0; i < state.capabilityCount; i++) {
+			if (state.capabilities[i].name == name) {
+				return &state.capabilities[i];
+			}
+		}
+		if (state.capabilityCount < maxCapabilities) {
+			state.capabilities[state.capabilityCount] = { name, -1 };
+			return &state.capabilities[state.capabilityCount++];
+		}
+		return nullptr;
+	}
+
+	// Returns whether the call has to be made, and counts it either way
+	template <typename T>
+	bool change(T& cached, T value) {
+		if (cached == value) {
+			RenderStats::countStateSkipped();
+			return false;
+		}
+		cached = value;
+		RenderStats::countStateChange();
+		return true;
+	}
+}
+
+
+void GLState::init() {
+	state.directStateAccess = GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access;
+	Log::info("GL_STATE {}", state.directStateAccess ? "using direct state access" : "binding to edit, no direct state access");
+	invalidate();
+}
+
+
+bool GLState::hasDirectStateAccess() {
+	return state.directStateAccess;
+}
+
+
+void GLState::invalidate() {
+	for (int i = 0; i < state.capabilityCount; i++) {
+		state.capabilities[i].enabled = -1;
+	}
+	state.depthFunc = unknownEnum;
+	state.depthMask = GLboolean(0xff);
+	state.blendSource = unknownEnum;
+	state.blendDestination = unknownEnum;
+
+	state.program = unknown;
+	state.vertexArray = unknown;
+	std::fill(std::begin(state.buffers), std::end(state.buffers), unknown);
+	state.readFramebuffer = unknown;
+	state.drawFramebuffer = unknown;
+	state.activeUnit = unknown;
+	for (auto& unit : state.textures) {
+		std::fill(std::begin(unit), std::end(unit), unknown);
+	}
+}
+
+
+void GLState::enable(GLenum name) {
+	setEnabled(name, true);
+}
+
+
+void GLState::disable(GLenum name) {
+	setEnabled(name, false);
+}
+
+
+void GLState::setEnabled(GLenum name, bool enabled) {
+	Capability* cached = capability(name);
+	if (cached != nullptr && !change(cached->enabled, enabled ? 1 : 0)) {
+		return;
+	}
+	if (enabled) {
+		glEnable(name);
+	} else {
+		glDisable(name);
+	}
+}
+
+
+void GLState::depthFunc(GLenum func) {
+	if (change(state.depthFunc, func)) {
+		glDepthFunc(func);
+	}
+}
+
+
+void GLState::depthMask(GLboolean mask) {
+	if (change(state.depthMask, mask)) {
+		glDepthMask(mask);
+	}
+}
+
+
+void GLState::blendFunc(GLenum source, GLenum destination) {
+	if (state.blendSource == source && state.blendDestination == destination) {
+		RenderStats::countStateSkipped();
+		return;
+	}
+	state.blendSource = source;
+	state.blendDestination = destination;
+	RenderStats::countStateChange();
+	glBlendFunc(source, destination);
+}
+
+
+void GLState::useProgram(GLuint program) {
+	if (change(state.program, program)) {
+		glUseProgram(program);
+	}
+}
+
+
+void GLState::bindVertexArray(GLuint vertexArray) {
+	if (change(state.vertexArray, vertexArray)) {
+		glBindVertexArray(vertexArray);
+
+		// The element array binding is part of the vertex array
+		state.buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+	}
+}
+
+
+void GLState::bindBuffer(GLenum target, GLuint buffer) {
+	int slot = bufferSlot(target);
+	if (slot < 0 || change(state.buffers[slot], buffer)) {
+		glBindBuffer(target, buffer);
+	}
+}
+
+
+void GLState::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	// Like bindBufferRange, indexed bindings aren't cached
+	glBindBufferBase(target, index, buffer);
+	int slot = bufferSlot(target);
+	if (slot >= 0) {
+		state.buffers[slot] = buffer;
+	}
+}
+
+
+void GLState::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	// Ranges move every call, so this is never skipped, but it also binds
+	// the generic target
+	glBindBufferRange(target, index, buffer, offset, size);
+	int slot = bufferSlot(target);
+	if (slot >= 0) {
+		state.buffers[slot] = buffer;
+	}
+}
+
+
+void GLState::bindFramebuffer(GLenum target, GLuint framebuffer) {
+	if (target == GL_FRAMEBUFFER) {
+		if (state.readFramebuffer == framebuffer && state.drawFramebuffer == framebuffer) {
+			RenderStats::countStateSkipped();
+			return;
+		}
+		state.readFramebuffer = framebuffer;
+		state.drawFramebuffer = framebuffer;
+		RenderStats::countStateChange();
+		glBindFramebuffer(target, framebuffer);
+		return;
+	}
+
+	GLuint& cached = target == GL_READ_FRAMEBUFFER ? state.readFramebuffer : state.drawFramebuffer;
+	if (change(cached, framebuffer)) {
+		glBindFramebuffer(target, framebuffer);
+	}
+}
+
+
+void GLState::bindTexture(GLuint unit, GLenum target, GLuint texture) {
+	int slot = textureSlot(target);
+	if (unit >= GLuint(maxTextureUnits) || slot < 0) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(target, texture);
+		state.activeUnit = unit;
+		RenderStats::countTextureBind();
+		return;
+	}
+
+	if (!change(state.textures[unit][slot], texture)) {
+		return;
+	}
+	RenderStats::countTextureBind();
+
+	if (state.directStateAccess) {
+		// Unbinding through DSA clears every target on the unit
+		glBindTextureUnit(unit, texture);
+		if (texture == 0) {
+			std::fill(std::begin(state.textures[unit]), std::end(state.textures[unit]), 0);
+		}
+		return;
+	}
+
+	if (state.activeUnit != unit) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		state.activeUnit = unit;
+	}
+	glBindTexture(target, texture);
+}
+
+
+void GLState::bufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage) {
+	if (state.directStateAccess) {
+		glNamedBufferData(buffer, size, data, usage);
+		return;
+	}
+	bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, size, data, usage);
+}
+
+
+void GLState::bufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data) {
+	if (state.directStateAccess) {
+		glNamedBufferSubData(buffer, offset, size, data);
+		return;
+	}
+	bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+}
+
+
+void GLState::forgetProgram(GLuint program) {
+	// A deleted program stays in use until another is bound
+	if (state.program == program) {
+		state.program = unknown;
+	}
+}
+
+
+void GLState::forgetVertexArray(GLuint vertexArray) {
+	if (state.vertexArray == vertexArray) {
+		state.vertexArray = 0;
+	}
+}
+
+
+void GLState::forgetBuffer(GLuint buffer) {
+	for (GLuint& bound : state.buffers) {
+		if (bound == buffer) {
+			bound = 0;
+		}
+	}
+}
+
+
+void GLState::forgetFramebuffer(GLuint framebuffer) {
+	if (state.readFramebuffer == framebuffer) {
+		state.readFramebuffer = 0;
+	}
+	if (state.drawFramebuffer == framebuffer) {
+		state.drawFramebuffer = 0;
+	}
+}
+
+
+void GLState::forgetTexture(GLuint texture) {
+	for (auto& unit : state.textures) {
+		for (GLuint& bound : unit) {
+			if (bound == texture) {
+				bound = 0;
+			}
+		}
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a cache of the OpenGL state the renderers touch.
+//
+// Every enable, bind and program switch goes through here, and calls that
+// wouldn't change anything are skipped. The cache only stays right if
+// nothing else changes the same state, so code outside the renderers that
+// does (middleware, say) must restore it or call invalidate() afterwards.
+// ImGui's OpenGL backend restores what it changes.
+//
+// The GLHandles destructors report deleted names, because GL silently
+// unbinds an object when it's deleted and the name may be handed out again.
+//
+// Where GL 4.5 or ARB_direct_state_access is available, buffer updates and
+// texture binds use the DSA entry points and need no bind-to-edit.
+//
+// Example:
+//		GLState::enable(GL_DEPTH_TEST);			// issued
+//		GLState::enable(GL_DEPTH_TEST);			// skipped
+//		GLState::bindTexture(0, GL_TEXTURE_2D, id);
+//------------------------------------------------------------------------------
+
+#include <GL/glew.h>
+
+
+namespace GLState {
+
+	// Call once GLEW is initialized for the context
+	void init();
+	bool hasDirectStateAccess();
+
+	// Forget everything; the next request for each piece of state is issued
+	void invalidate();
+
+	// Capabilities and fixed-function state
+	void enable(GLenum capability);
+	void disable(GLenum capability);
+	void setEnabled(GLenum capability, bool enabled);
+	void depthFunc(GLenum func);
+	void depthMask(GLboolean mask);
+	void blendFunc(GLenum source, GLenum destination);
+
+	// Bindings
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vertexArray);
+	void bindBuffer(GLenum target, GLuint buffer);
+	void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+	void bindFramebuffer(GLenum target, GLuint framebuffer);
+	void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+	// Buffer updates, through DSA when available and bind-to-edit otherwise
+	void bufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage);
+	void bufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data);
+
+	// Called from the GLHandles destructors
+	void forgetProgram(GLuint program);
+	void forgetVertexArray(GLuint vertexArray);
+	void forgetBuffer(GLuint buffer);
+	void forgetFramebuffer(GLuint framebuffer);
+	void forgetTexture(GLuint texture);
+}
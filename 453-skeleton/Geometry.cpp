@@ -1,5 +1,7 @@
 #include "Geometry.h"
 
+#include "RenderStats.h"
+
 #include <utility>
 
 
@@ -12,6 +14,13 @@ GPU_Geometry::GPU_Geometry()
 {}
 
 
+void GPU_Geometry::draw(GLenum mode, GLint first, GLsizei count) {
+	vao.bind();
+	glDrawArrays(mode, first, count);
+	RenderStats::countDraw(count);
+}
+
+
 void GPU_Geometry::setVerts(const std::vector<glm::vec3>& verts) {
 	vertBuffer.uploadData(sizeof(glm::vec3) * verts.size(), verts.data(), GL_STATIC_DRAW);
 }
@@ -32,6 +32,10 @@ public:
 
 	// Public interface
 	void bind() { vao.bind(); }
+	GLuint vertexArray() const { return vao.id(); }
+
+	// Binds the geometry and draws count vertices starting at first
+	void draw(GLenum mode, GLint first, GLsizei count);
 
 	void setVerts(const std::vector<glm::vec3>& verts);
 	void setCols(const std::vector<glm::vec3>& cols);
@@ -0,0 +1,155 @@
+#include "GpuProfiler.h"
+
+#include "Log.h"
+
+#include "imgui/imgui.h"
+
+#include <fstream>
+
+
+namespace {
+	// How many resolved frames are kept for the CSV dump
+	const size_t historyLength = 1000;
+
+	// Weight of the newest sample in the smoothed averages
+	const double smoothing = 0.05;
+}
+
+
+GpuProfiler::GpuProfiler(int framesInFlight, int maxPassesPerFrame)
+	: framesInFlight(framesInFlight)
+	, maxPasses(maxPassesPerFrame)
+	, queries(framesInFlight * maxPassesPerFrame)
+	, slots(framesInFlight)
+	, frame(0)
+	, current(0)
+	, open(false)
+	, latest{ 0, {} }
+	, dropped(0)
+{
+	glGenQueries(GLsizei(queries.size()), queries.data());
+}
+
+
+GpuProfiler::~GpuProfiler() {
+	glDeleteQueries(GLsizei(queries.size()), queries.data());
+}
+
+
+void GpuProfiler::beginFrame() {
+	current = int(frame % framesInFlight);
+
+	// This slot was last used framesInFlight frames ago; read it before reuse
+	Slot& slot = slots[current];
+	if (!slot.names.empty()) {
+		resolve(slot, current);
+	}
+	slot.frame = frame;
+	slot.names.clear();
+}
+
+
+void GpuProfiler::endFrame() {
+	if (open) {
+		end();
+	}
+	frame++;
+}
+
+
+void GpuProfiler::begin(const char* name) {
+	if (open) {
+		end();
+	}
+
+	Slot& slot = slots[current];
+	if (int(slot.names.size()) >= maxPasses) {
+		return;
+	}
+	glBeginQuery(GL_TIME_ELAPSED, queries[current * maxPasses + slot.names.size()]);
+	slot.names.push_back(name);
+	open = true;
+}
+
+
+void GpuProfiler::end() {
+	if (open) {
+		glEndQuery(GL_TIME_ELAPSED);
+		open = false;
+	}
+}
+
+
+void GpuProfiler::resolve(Slot& slot, int slotIndex) {
+	const GLuint* slotQueries = &queries[slotIndex * maxPasses];
+
+	// Results become available in order, so checking the last one is enough
+	GLint available = 0;
+	glGetQueryObjectiv(slotQueries[slot.names.size() - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		dropped++;
+		return;
+	}
+
+	FrameTiming timing{ slot.frame, {} };
+	for (size_t i = 0; i < slot.names.size(); i++) {
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(slotQueries[i], GL_QUERY_RESULT, &nanoseconds);
+		double ms = double(nanoseconds) * 1e-6;
+		timing.passes.push_back({ slot.names[i], ms });
+
+		auto it = averages.find(slot.names[i]);
+		if (it == averages.end()) {
+			averages[slot.names[i]] = ms;
+		} else {
+			it->second += smoothing * (ms - it->second);
+		}
+	}
+
+	latest = timing;
+	history.push_back(std::move(timing));
+	if (history.size() > historyLength) {
+		history.pop_front();
+	}
+}
+
+
+void GpuProfiler::drawImGui(bool* visible) {
+	if (!ImGui::Begin("GPU Profiler", visible, ImGuiWindowFlags_AlwaysAutoResize)) {
+		ImGui::End();
+		return;
+	}
+
+	double total = 0.0;
+	ImGui::Text("%-16s %9s %9s", "pass", "last ms", "avg ms");
+	for (const PassTiming& pass : latest.passes) {
+		ImGui::Text("%-16s %9.3f %9.3f", pass.name.c_str(), pass.milliseconds, averages[pass.name]);
+		total += pass.milliseconds;
+	}
+	ImGui::Separator();
+	ImGui::Text("%-16s %9.3f", "total", total);
+	ImGui::Text("frame %llu, %llu dropped", latest.frame, dropped);
+
+	if (ImGui::Button("Write gpu_timings.csv")) {
+		writeCsv("gpu_timings.csv");
+	}
+	ImGui::End();
+}
+
+
+bool GpuProfiler::writeCsv(const std::string& path) const {
+	std::ofstream file(path);
+	if (!file) {
+		Log::error("GPU_PROFILER unable to write {}", path);
+		return false;
+	}
+
+	file << "frame,pass,milliseconds\n";
+	for (const FrameTiming& timing : history) {
+		for (const PassTiming& pass : timing.passes) {
+			file << timing.frame << ',' << pass.name << ',' << pass.milliseconds << '\n';
+		}
+	}
+	Log::info("GPU_PROFILER wrote {} frames to {}", history.size(), path);
+	return true;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a GPU timer for render passes.
+//
+// Each pass is wrapped in a GL_TIME_ELAPSED query. Queries come from a pool
+// that is split into one slot per frame in flight, and a slot is only read
+// back when it comes around again a few frames later, by which point the GPU
+// has almost always finished with it. Reading results therefore never stalls
+// the pipeline; a slot that still isn't ready is dropped instead.
+//
+// Example:
+//		profiler.beginFrame();
+//		{
+//			GpuProfiler::Scope pass(profiler, "earth");
+//			... draw calls ...
+//		}
+//		profiler.endFrame();
+//------------------------------------------------------------------------------
+
+#include <GL/glew.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+
+class GpuProfiler {
+
+public:
+	struct PassTiming {
+		std::string name;
+		double milliseconds;
+	};
+
+	struct FrameTiming {
+		unsigned long long frame;
+		std::vector<PassTiming> passes;
+	};
+
+	GpuProfiler(int framesInFlight = 4, int maxPassesPerFrame = 32);
+
+	// The query pool is raw GL names, so copying would double-delete them
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler operator=(const GpuProfiler&) = delete;
+
+	~GpuProfiler();
+
+	// Public interface
+	void beginFrame();
+	void endFrame();
+
+	// GL_TIME_ELAPSED queries can't overlap, so passes can't nest. Beginning
+	// a pass while another is open ends the open one first.
+	void begin(const char* name);
+	void end();
+
+	// The most recently resolved frame, a few frames behind the current one
+	const FrameTiming& getLatest() const { return latest; }
+
+	// Exponentially smoothed milliseconds per pass name
+	const std::map<std::string, double>& getAverages() const { return averages; }
+
+	unsigned long long getDroppedFrames() const { return dropped; }
+
+	void drawImGui(bool* visible);
+	bool writeCsv(const std::string& path) const;
+
+	// RAII helper for a single pass
+	class Scope {
+	public:
+		Scope(GpuProfiler& profiler, const char* name) : profiler(profiler) { profiler.begin(name); }
+		~Scope() { profiler.end(); }
+
+		Scope(const Scope&) = delete;
+		Scope operator=(const Scope&) = delete;
+
+	private:
+		GpuProfiler& profiler;
+	};
+
+private:
+	struct Slot {
+		unsigned long long frame;
+		std::vector<std::string> names;
+	};
+
+	int framesInFlight;
+	int maxPasses;
+	std::vector<GLuint> queries;
+	std::vector<Slot> slots;
+
+	unsigned long long frame;
+	int current;
+	bool open;
+
+	FrameTiming latest;
+	std::map<std::string, double> averages;
+	std::deque<FrameTiming> history;
+	unsigned long long dropped;
+
+	void resolve(Slot& slot, int slotIndex);
+};
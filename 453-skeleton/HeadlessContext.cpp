@@ -0,0 +1,184 @@
+#include "HeadlessContext.h"
+
+#include "Log.h"
+
+#include <GL/glew.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#if ORRERY_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+
+#if ORRERY_HEADLESS
+
+namespace {
+
+	bool hasExtension(const char* extensions, const char* name) {
+		if (extensions == nullptr) {
+			return false;
+		}
+
+		// Extension strings are space separated; avoid matching prefixes
+		size_t length = std::strlen(name);
+		for (const char* p = std::strstr(extensions, name); p != nullptr; p = std::strstr(p + length, name)) {
+			bool startsWord = p == extensions || p[-1] == ' ';
+			bool endsWord = p[length] == ' ' || p[length] == '\0';
+			if (startsWord && endsWord) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	EGLDisplay openDisplay() {
+		const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+		auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+			eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+		if (getPlatformDisplay != nullptr && hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+			EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+			if (display != EGL_NO_DISPLAY) {
+				Log::info("HEADLESS using the surfaceless platform");
+				return display;
+			}
+		}
+
+		auto queryDevices = reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(eglGetProcAddress("eglQueryDevicesEXT"));
+		if (getPlatformDisplay != nullptr && queryDevices != nullptr && hasExtension(clientExtensions, "EGL_EXT_platform_device")) {
+			EGLDeviceEXT device;
+			EGLint count = 0;
+			if (queryDevices(1, &device, &count) && count > 0) {
+				EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, device, nullptr);
+				if (display != EGL_NO_DISPLAY) {
+					Log::info("HEADLESS using the first EGL device");
+					return display;
+				}
+			}
+		}
+
+		Log::info("HEADLESS using the default EGL display");
+		return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+}
+
+
+HeadlessContext::HeadlessContext(int width, int height, ContextMode mode)
+	: display(EGL_NO_DISPLAY)
+	, context(EGL_NO_CONTEXT)
+	, surface(EGL_NO_SURFACE)
+	, size(width, height)
+{
+	display = openDisplay();
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+		Log::error("HEADLESS failed to initialize an EGL display");
+		throw std::runtime_error("Failed to initialize EGL.");
+	}
+	Log::info("HEADLESS EGL {}.{} ({})", major, minor, eglQueryString(display, EGL_VENDOR));
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		Log::error("HEADLESS EGL display doesn't support desktop OpenGL");
+		throw std::runtime_error("Failed to bind the OpenGL API.");
+	}
+
+	// Depth and colour live in our own framebuffer, so the config only needs
+	// to support desktop GL. Pbuffers are only needed without surfaceless.
+	const char* displayExtensions = eglQueryString(display, EGL_EXTENSIONS);
+	bool surfaceless = hasExtension(displayExtensions, "EGL_KHR_surfaceless_context");
+	const EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint configCount = 0;
+	if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+		Log::error("HEADLESS no EGL config supports desktop OpenGL");
+		throw std::runtime_error("Failed to choose an EGL config.");
+	}
+
+	// Same context the GLFW window asks for
+	bool diagnostic = mode == ContextMode::Diagnostic;
+	EGLint flags = EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE_BIT_KHR | (diagnostic ? EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR : 0);
+	bool noError = !diagnostic && hasExtension(displayExtensions, "EGL_KHR_create_context_no_error");
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+		EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+		EGL_CONTEXT_FLAGS_KHR, flags,
+		// Drivers without the extension reject the attribute, so end the list early
+		noError ? EGL_CONTEXT_OPENGL_NO_ERROR_KHR : EGL_NONE, EGL_TRUE,
+		EGL_NONE
+	};
+	context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT) {
+		Log::error("HEADLESS failed to create a 3.3 core context: EGL error {:#x}", eglGetError());
+		throw std::runtime_error("Failed to create EGL context.");
+	}
+
+	if (!surfaceless) {
+		const EGLint surfaceAttributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+		surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+		if (surface == EGL_NO_SURFACE) {
+			Log::error("HEADLESS failed to create a {}x{} pbuffer", width, height);
+			throw std::runtime_error("Failed to create EGL pbuffer.");
+		}
+	}
+	makeCurrent();
+
+	// GLEW 2.1 finishes with glxewInit, which has no display to query here.
+	// The GL entry points are already loaded by then, so that error is fine.
+	GLenum err = glewInit();
+	if (err != GLEW_OK && err != GLEW_ERROR_NO_GLX_DISPLAY) {
+		Log::error("HEADLESS glewInit error:{}", glewGetErrorString(err));
+		throw std::runtime_error("Failed to initialize GLEW");
+	}
+	Log::info("HEADLESS rendering {}x{} on {}", width, height, glGetString(GL_RENDERER));
+}
+
+
+HeadlessContext::~HeadlessContext() {
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (surface != EGL_NO_SURFACE) {
+		eglDestroySurface(display, surface);
+	}
+	if (context != EGL_NO_CONTEXT) {
+		eglDestroyContext(display, context);
+	}
+	eglTerminate(display);
+}
+
+
+void HeadlessContext::makeCurrent() {
+	if (!eglMakeCurrent(display, surface, surface, context)) {
+		Log::error("HEADLESS eglMakeCurrent failed: EGL error {:#x}", eglGetError());
+		throw std::runtime_error("Failed to make the EGL context current.");
+	}
+}
+
+#else
+
+HeadlessContext::HeadlessContext(int width, int height, ContextMode)
+	: display(nullptr)
+	, context(nullptr)
+	, surface(nullptr)
+	, size(width, height)
+{
+	Log::error("HEADLESS this build has no EGL support");
+	throw std::runtime_error("Headless rendering is unavailable.");
+}
+
+
+HeadlessContext::~HeadlessContext() {}
+
+
+void HeadlessContext::makeCurrent() {}
+
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains an OpenGL context that needs no display at all.
+//
+// The context is created through EGL, preferring Mesa's surfaceless platform
+// (which runs on llvmpipe with no GPU and no X server), then the first EGL
+// device, then the default display. It asks for the same 3.3 core context
+// the GLFW window does, so every renderer works unchanged; frames are drawn
+// into a Framebuffer instead of a window.
+//
+// Only available when the build found EGL (ORRERY_HEADLESS); otherwise the
+// constructor throws.
+//------------------------------------------------------------------------------
+
+#include "ContextMode.h"
+
+#include <glm/glm.hpp>
+
+
+class HeadlessContext {
+
+public:
+	HeadlessContext(int width, int height, ContextMode mode = ContextMode::Diagnostic);
+
+	// EGL handles aren't reference counted, so copying would double-destroy
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext operator=(const HeadlessContext&) = delete;
+
+	~HeadlessContext();
+
+	// Public interface
+	void makeCurrent();
+	glm::ivec2 getSize() const { return size; }
+
+private:
+	// EGL types are opaque pointers; keeping them as void* here means only
+	// HeadlessContext.cpp needs the EGL headers
+	void* display;
+	void* context;
+	void* surface;
+	glm::ivec2 size;
+};
@@ -0,0 +1,37 @@
+#define _USE_MATH_DEFINES
+#include "Kepler.h"
+
+#include <cmath>
+
+
+double Kepler::eccentricAnomaly(double M, double e) {
+	M = std::remainder(M, 2.0 * M_PI);
+	double E = e < 0.8 ? M : (M < 0.0 ? -M_PI : M_PI);
+	for (int i = 0; i < 16; i++) {
+		double step = (E - e * std::sin(E) - M) / (1.0 - e * std::cos(E));
+		E -= step;
+		if (std::abs(step) < 1e-12) {
+			break;
+		}
+	}
+	return E;
+}
+
+
+glm::dvec3 Kepler::position(double a, double e, double inclination, double ascendingNode,
+	double argumentOfPeriapsis, double meanAnomaly)
+{
+	double E = eccentricAnomaly(meanAnomaly, e);
+	glm::dvec3 p(a * (std::cos(E) - e), a * std::sqrt(1.0 - e * e) * std::sin(E), 0.0);
+
+	auto rotateZ = [](glm::dvec3 v, double angle) {
+		return glm::dvec3(v.x * std::cos(angle) - v.y * std::sin(angle), v.x * std::sin(angle) + v.y * std::cos(angle), v.z);
+	};
+	auto rotateX = [](glm::dvec3 v, double angle) {
+		return glm::dvec3(v.x, v.y * std::cos(angle) - v.z * std::sin(angle), v.y * std::sin(angle) + v.z * std::cos(angle));
+	};
+	p = rotateZ(p, argumentOfPeriapsis);
+	p = rotateX(p, inclination);
+	p = rotateZ(p, ascendingNode);
+	return p;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains two-body orbit helpers shared by everything that places
+// bodies from Keplerian elements.
+//
+// Positions are in the frame the elements are referred to, with the same
+// rotations as shaders/orbit.vert: periapsis about z, then inclination about
+// x, then the ascending node about z.
+//------------------------------------------------------------------------------
+
+#include <glm/glm.hpp>
+
+
+namespace Kepler {
+
+	// Solves M = E - e sin E for elliptic orbits (e < 1) by Newton's method
+	double eccentricAnomaly(double meanAnomaly, double eccentricity);
+
+	// Position relative to the focus, in the units of a
+	glm::dvec3 position(double a, double e, double inclination, double ascendingNode,
+		double argumentOfPeriapsis, double meanAnomaly);
+}
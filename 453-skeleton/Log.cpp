@@ -0,0 +1,346 @@
+#include "Log.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+	// Messages in flight; a power of two so positions wrap with a mask
+	const size_t queueSize = 1 << 12;
+
+	// How long the writer sleeps when a wake-up is missed
+	const auto idleWait = std::chrono::milliseconds(5);
+
+	// vivid's ansi colours, without pulling vivid into every file
+	const char* reset = "\x1b[0m";
+
+	struct LevelStyle {
+		const char* prefix;
+		const char* colour;
+	};
+
+	const LevelStyle styles[] = {
+		{ "DEBUG", "\x1b[38;5;40m" },
+		{ "INFO", "\x1b[38;5;15m" },
+		{ "WARN", "\x1b[38;5;220m" },
+		{ "ERROR", "\x1b[38;5;196m" },
+	};
+
+	// A bounded multi-producer queue (Dmitry Vyukov's design) with a single
+	// consumer. Each slot's sequence says whose turn it is: pos when free for
+	// the producer claiming pos, pos + 1 once that message is in it.
+	struct Slot {
+		std::atomic<size_t> sequence;
+		Log::Level level;
+		std::string text;
+	};
+
+	void append(std::string& out, Log::Level level, const std::string& text, bool colour) {
+		const LevelStyle& style = styles[int(level)];
+		if (colour) {
+			out += style.colour;
+		}
+		out += '[';
+		out += style.prefix;
+		out += ']';
+		if (colour) {
+			out += reset;
+		}
+		out += ": ";
+		out += text;
+		out += '\n';
+	}
+
+
+	class Writer {
+
+	public:
+		Writer()
+			: slots(queueSize)
+			, enqueuePos(0)
+			, dequeuePos(0)
+			, drained(0)
+			, dropped(0)
+			, reportedDropped(0)
+			, policy(Log::Overflow::Drop)
+			, file(nullptr)
+			, waiting(false)
+			, stopping(false)
+		{
+			for (size_t i = 0; i < queueSize; i++) {
+				slots[i].sequence.store(i, std::memory_order_relaxed);
+			}
+			thread = std::thread(&Writer::run, this);
+		}
+
+		~Writer() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			wake.notify_one();
+			thread.join();
+
+			if (file != nullptr) {
+				std::fclose(file);
+			}
+		}
+
+		Writer(const Writer&) = delete;
+		Writer operator=(const Writer&) = delete;
+
+		void push(Log::Level level, std::string&& text) {
+			bool block = level == Log::Level::Error || policy.load(std::memory_order_relaxed) == Log::Overflow::Block;
+			while (!tryPush(level, text)) {
+				if (!block) {
+					dropped.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}
+				wake.notify_one();
+				std::this_thread::yield();
+			}
+
+			if (waiting.load(std::memory_order_relaxed)) {
+				wake.notify_one();
+			}
+		}
+
+		void flush() {
+			size_t target = enqueuePos.load(std::memory_order_acquire);
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.notify_one();
+			done.wait(lock, [&]() { return drained >= target || stopping; });
+		}
+
+		// Called from crash handlers. The writer thread may be mid-drain, so
+		// take the consumer role from it rather than draining alongside it.
+		void drainFromHandler() {
+			bool expected = false;
+			for (int spins = 0; spins < 1000; spins++) {
+				if (consuming.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+					drainOnce();
+					consuming.store(false, std::memory_order_release);
+					return;
+				}
+				expected = false;
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			}
+		}
+
+		bool setFile(const std::string& path) {
+			std::FILE* opened = nullptr;
+			if (!path.empty()) {
+				opened = std::fopen(path.c_str(), "w");
+				if (opened == nullptr) {
+					return false;
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(sinkMutex);
+			if (file != nullptr) {
+				std::fclose(file);
+			}
+			file = opened;
+			return true;
+		}
+
+		void setOverflow(Log::Overflow overflow) { policy = overflow; }
+		unsigned long long getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+	private:
+		std::vector<Slot> slots;
+		alignas(64) std::atomic<size_t> enqueuePos;
+		alignas(64) size_t dequeuePos;	// only touched by whoever holds consuming
+
+		size_t drained;	// guarded by mutex, for flush()
+		std::atomic<unsigned long long> dropped;
+		unsigned long long reportedDropped;
+		std::atomic<Log::Overflow> policy;
+
+		std::mutex sinkMutex;
+		std::FILE* file;
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable done;
+		std::atomic<bool> waiting;
+		std::atomic<bool> consuming{ false };
+		bool stopping;
+
+		std::thread thread;
+
+		bool tryPush(Log::Level level, std::string& text) {
+			size_t pos = enqueuePos.load(std::memory_order_relaxed);
+			while (true) {
+				Slot& slot = slots[pos & (queueSize - 1)];
+				size_t sequence = slot.sequence.load(std::memory_order_acquire);
+				intptr_t difference = intptr_t(sequence) - intptr_t(pos);
+				if (difference == 0) {
+					if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						slot.level = level;
+						slot.text = std::move(text);
+						slot.sequence.store(pos + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (difference < 0) {
+					return false;	// full
+				}
+				else {
+					pos = enqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// Writes everything queued so far in one go. Returns how many.
+		size_t drainOnce() {
+			std::string console;
+			std::string plain;
+			size_t count = 0;
+
+			while (true) {
+				Slot& slot = slots[dequeuePos & (queueSize - 1)];
+				if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+					break;
+				}
+				append(console, slot.level, slot.text, true);
+				append(plain, slot.level, slot.text, false);
+				slot.text.clear();
+				slot.sequence.store(dequeuePos + queueSize, std::memory_order_release);
+				dequeuePos++;
+				count++;
+			}
+
+			unsigned long long lost = dropped.load(std::memory_order_relaxed);
+			if (lost != reportedDropped) {
+				std::string note = fmt::format("LOG queue full, dropped {} messages", lost - reportedDropped);
+				append(console, Log::Level::Warn, note, true);
+				append(plain, Log::Level::Warn, note, false);
+				reportedDropped = lost;
+			}
+
+			if (!console.empty()) {
+				std::lock_guard<std::mutex> lock(sinkMutex);
+				std::fwrite(console.data(), 1, console.size(), stdout);
+				std::fflush(stdout);
+				if (file != nullptr) {
+					std::fwrite(plain.data(), 1, plain.size(), file);
+					std::fflush(file);
+				}
+			}
+			return count;
+		}
+
+		void run() {
+			size_t position = 0;
+			while (true) {
+				// A crash handler may hold the consumer role; skip a turn then
+				size_t count = 0;
+				bool expected = false;
+				if (consuming.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+					count = drainOnce();
+					position = dequeuePos;
+					consuming.store(false, std::memory_order_release);
+				}
+
+				std::unique_lock<std::mutex> lock(mutex);
+				drained = position;
+				done.notify_all();
+				if (stopping && enqueuePos.load(std::memory_order_acquire) == position) {
+					return;
+				}
+				if (count == 0 && !stopping) {
+					waiting = true;
+					wake.wait_for(lock, idleWait);
+					waiting = false;
+				}
+			}
+		}
+	};
+
+
+	// Set while the writer exists, so logging during static destruction
+	// falls back to writing directly
+	std::atomic<bool> alive{ false };
+
+	void onSignal(int signal);
+
+	Writer& writer() {
+		static Writer instance;
+		static bool registered = []() {
+			alive = true;
+			std::set_terminate([]() {
+				Log::flush();
+				std::abort();
+			});
+			for (int signal : { SIGSEGV, SIGABRT, SIGFPE, SIGILL }) {
+				std::signal(signal, onSignal);
+			}
+			return true;
+		}();
+		(void)registered;
+		return instance;
+	}
+
+	// Not async-signal-safe, but the process is going down anyway and the
+	// last few messages are usually the ones that explain why
+	void onSignal(int signal) {
+		if (alive) {
+			writer().drainFromHandler();
+		}
+		std::signal(signal, SIG_DFL);
+		std::raise(signal);
+	}
+
+	struct Shutdown {
+		~Shutdown() { alive = false; }
+	};
+}
+
+
+void Log::write(Level level, std::string message) {
+	Writer& instance = writer();
+
+	// Constructed after the writer, so destroyed (and marks it gone) first
+	static Shutdown shutdown;
+	(void)shutdown;
+
+	if (!alive) {
+		std::string line;
+		append(line, level, message, true);
+		std::fwrite(line.data(), 1, line.size(), stdout);
+		return;
+	}
+	instance.push(level, std::move(message));
+}
+
+
+void Log::setOverflow(Overflow policy) {
+	writer().setOverflow(policy);
+}
+
+
+bool Log::setFile(const std::string& path) {
+	return writer().setFile(path);
+}
+
+
+void Log::flush() {
+	if (alive) {
+		writer().flush();
+	}
+}
+
+
+unsigned long long Log::getDropped() {
+	return writer().getDropped();
+}
@@ -10,51 +10,82 @@
 //		  Log::warning("Elapsed time: {0:.2f} seconds", 1.23);
 //		  Log::error("Elapsed time: {0:.2f} seconds", 1.23);
 //
+// Messages are formatted on the calling thread and pushed into a lock-free
+// queue; a background thread writes them to stdout (and a file, if set), so
+// logging never waits on terminal I/O. Anything queued is still written on
+// exit, on flush(), and if the program crashes.
+//
+// Levels below ORRERY_LOG_LEVEL (0 debug, 1 info, 2 warn, 3 error, 4 none)
+// are compiled out: they don't format or queue anything.
+//
 // This code isn't intented for your review. Of course, if you feel like it, dive
 // right in.
 //------------------------------------------------------------------------------
 
 #include <fmt/format.h>
-#include <vivid/vivid.h>
 
+#include <string>
+
+#ifndef ORRERY_LOG_LEVEL
+#define ORRERY_LOG_LEVEL 0
+#endif
 
 
 namespace Log {
-	namespace ansi = vivid::ansi;
-	template <typename S1, typename S2, typename S3, typename... Args>
-	void _log(const S1 &prefix, const S2 &c, const S3 &format_str, Args&&... args) {
-		fmt::print(
-			"{}[{}]{}: {}\n",
-			c,
-			prefix,
-			ansi::reset,
-			fmt::format(format_str, std::forward<Args>(args)...)
-		);
+
+	enum class Level { Debug = 0, Info = 1, Warn = 2, Error = 3 };
+
+	// What to do when the queue is full. Errors always wait for room.
+	enum class Overflow {
+		Drop,	// count the message and carry on (default)
+		Block,	// wait for the writer to catch up
+	};
+
+	void setOverflow(Overflow policy);
+
+	// Also write every message (without colours) to path; empty stops that
+	bool setFile(const std::string& path);
+
+	// Returns once everything logged so far has been written
+	void flush();
+
+	// Messages lost to Overflow::Drop so far
+	unsigned long long getDropped();
+
+	// Queues an already formatted message
+	void write(Level level, std::string message);
+
+
+	template <Level level, typename S, typename... Args>
+	void _log(const S &format_str, Args&&... args) {
+		if constexpr (int(level) >= ORRERY_LOG_LEVEL) {
+			write(level, fmt::format(format_str, std::forward<Args>(args)...));
+		}
 	}
 
 
 	template <typename S, typename... Args>
 	void debug(const S &format_str, Args&&... args) {
-		_log("DEBUG", ansi::green, format_str, args...);
+		_log<Level::Debug>(format_str, std::forward<Args>(args)...);
 	}
 
 	template <typename S, typename... Args>
 	void info(const S &format_str, Args&&... args) {
-		_log("INFO", ansi::white, format_str, args...);
+		_log<Level::Info>(format_str, std::forward<Args>(args)...);
 	}
 
 	template <typename S, typename... Args>
 	void warning(const S &format_str, Args&&... args) {
-		_log("WARN", ansi::yellow, format_str, args...);
+		_log<Level::Warn>(format_str, std::forward<Args>(args)...);
 	}
 	template <typename S, typename... Args>
 	void warn(const S &format_str, Args&&... args) {
-		_log("WARN", ansi::yellow, format_str, args...);
+		_log<Level::Warn>(format_str, std::forward<Args>(args)...);
 	}
 
 	template <typename S, typename... Args>
 	void error(const S &format_str, Args&&... args) {
-		_log("ERROR", ansi::red, format_str, args...);
+		_log<Level::Error>(format_str, std::forward<Args>(args)...);
 	}
 
 
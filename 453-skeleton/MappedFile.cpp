@@ -0,0 +1,137 @@
+#include "MappedFile.h"
+
+#include "Log.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path)
+	: path(path), bytes(nullptr), length(0), fileHandle(nullptr), mappingHandle(nullptr)
+{
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		Log::error("MAPPED_FILE unable to open {}", path);
+		throw std::runtime_error("Failed to open file for mapping.");
+	}
+	fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	length = size_t(fileSize.QuadPart);
+
+	// Windows refuses to map empty files, and there is nothing to map anyway
+	if (length == 0) {
+		return;
+	}
+
+	mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle != nullptr) {
+		bytes = static_cast<const unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	}
+	if (bytes == nullptr) {
+		unmap();
+		Log::error("MAPPED_FILE unable to map {}", path);
+		throw std::runtime_error("Failed to map file.");
+	}
+}
+
+
+void MappedFile::unmap() {
+	if (bytes != nullptr) UnmapViewOfFile(bytes);
+	if (mappingHandle != nullptr) CloseHandle(mappingHandle);
+	if (fileHandle != nullptr) CloseHandle(fileHandle);
+	bytes = nullptr;
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+	length = 0;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+	: path(path), bytes(nullptr), length(0)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		Log::error("MAPPED_FILE unable to open {}", path);
+		throw std::runtime_error("Failed to open file for mapping.");
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		Log::error("MAPPED_FILE unable to stat {}", path);
+		throw std::runtime_error("Failed to open file for mapping.");
+	}
+	length = size_t(info.st_size);
+
+	if (length > 0) {
+		void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (address == MAP_FAILED) {
+			close(fd);
+			Log::error("MAPPED_FILE unable to map {}", path);
+			throw std::runtime_error("Failed to map file.");
+		}
+		bytes = static_cast<const unsigned char*>(address);
+	}
+
+	// The mapping keeps its own reference to the file
+	close(fd);
+}
+
+
+void MappedFile::unmap() {
+	if (bytes != nullptr) {
+		munmap(const_cast<unsigned char*>(bytes), length);
+	}
+	bytes = nullptr;
+	length = 0;
+}
+
+#endif
+
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: path(std::move(other.path)), bytes(other.bytes), length(other.length)
+#ifdef _WIN32
+	, fileHandle(other.fileHandle), mappingHandle(other.mappingHandle)
+#endif
+{
+	other.bytes = nullptr;
+	other.length = 0;
+#ifdef _WIN32
+	other.fileHandle = nullptr;
+	other.mappingHandle = nullptr;
+#endif
+}
+
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	std::swap(path, other.path);
+	std::swap(bytes, other.bytes);
+	std::swap(length, other.length);
+#ifdef _WIN32
+	std::swap(fileHandle, other.fileHandle);
+	std::swap(mappingHandle, other.mappingHandle);
+#endif
+	return *this;
+}
+
+
+MappedFile::~MappedFile() {
+	unmap();
+}
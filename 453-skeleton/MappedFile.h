@@ -0,0 +1,44 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a read-only memory mapped file following RAII principles.
+//
+// Mapping a file lets binary data (star catalogs, caches, ephemerides) be used
+// in place, with the operating system paging in only what is touched.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <string>
+
+
+class MappedFile {
+
+public:
+	explicit MappedFile(const std::string& path);
+
+	// Copying a mapping would unmap it twice. Moving hands it over.
+	MappedFile(const MappedFile&) = delete;
+	MappedFile operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	~MappedFile();
+
+	// Public interface
+	const unsigned char* data() const { return bytes; }
+	size_t size() const { return length; }
+	std::string getPath() const { return path; }
+
+private:
+	std::string path;
+	const unsigned char* bytes;
+	size_t length;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+
+	void unmap();
+};
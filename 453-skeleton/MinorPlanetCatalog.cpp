@@ -0,0 +1,338 @@
+#define _USE_MATH_DEFINES
+#include "MinorPlanetCatalog.h"
+
+#include "BinaryCache.h"
+#include "Kepler.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+
+namespace {
+
+	const double degrees = M_PI / 180.0;
+
+	// Each thread gets at least this much of the file
+	const size_t minimumChunk = size_t(1) << 20;
+
+	// Data lines are at least this long; the columns after a are optional
+	const size_t minimumLine = 103;
+
+	// Offsets of the columns after the header, each 8 byte aligned
+	struct Layout {
+		size_t epoch;
+		size_t floats[8];
+		size_t designation;
+		size_t total;
+	};
+
+	Layout layout(size_t count) {
+		auto aligned = [](size_t bytes) { return (bytes + 7) & ~size_t(7); };
+		Layout l;
+		size_t offset = sizeof(MinorPlanetCatalog::Header);
+		l.epoch = offset;
+		offset += aligned(sizeof(double) * count);
+		for (size_t& column : l.floats) {
+			column = offset;
+			offset += aligned(sizeof(float) * count);
+		}
+		l.designation = offset;
+		offset += 8 * count;
+		l.total = offset;
+		return l;
+	}
+
+	// Reads a right or left justified decimal from a fixed width field, with
+	// no exponent. Blank fields fail.
+	bool readNumber(const char* begin, const char* end, double& value) {
+		static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+			1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+		while (begin < end && *begin == ' ') begin++;
+		while (end > begin && end[-1] == ' ') end--;
+		bool negative = begin < end && *begin == '-';
+		if (begin < end && (*begin == '-' || *begin == '+')) begin++;
+
+		uint64_t mantissa = 0;
+		int digits = 0;
+		int fraction = -1;
+		for (; begin < end; begin++) {
+			if (*begin >= '0' && *begin <= '9') {
+				if (digits == 18) return false;
+				mantissa = mantissa * 10 + uint64_t(*begin - '0');
+				digits++;
+				if (fraction >= 0) fraction++;
+			}
+			else if (*begin == '.' && fraction < 0) {
+				fraction = 0;
+			}
+			else {
+				return false;
+			}
+		}
+		if (digits == 0) {
+			return false;
+		}
+		// Both exact, so the quotient is correctly rounded
+		value = double(mantissa) / powers[std::max(fraction, 0)];
+		if (negative) value = -value;
+		return true;
+	}
+
+	// Digits of packed dates run 0-9 then A-V for 10-31
+	int unpack(char c) {
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'A' && c <= 'V') return c - 'A' + 10;
+		return -1;
+	}
+
+	// Packed epochs like K2555 are 0h TT on 2025 May 5
+	bool readEpoch(const char* field, double& julianDate) {
+		int century = unpack(field[0]);
+		int tens = unpack(field[1]);
+		int units = unpack(field[2]);
+		int month = unpack(field[3]);
+		int day = unpack(field[4]);
+		if (century < 0 || tens < 0 || tens > 9 || units < 0 || units > 9 || month < 1 || month > 12 || day < 1) {
+			return false;
+		}
+		int year = century * 100 + tens * 10 + units;
+
+		// Gregorian calendar to Julian date (Meeus, Astronomical Algorithms, 7.1)
+		if (month <= 2) {
+			year -= 1;
+			month += 12;
+		}
+		int a = year / 100;
+		int b = 2 - a + a / 4;
+		julianDate = std::floor(365.25 * (year + 4716)) + std::floor(30.6001 * (month + 1)) + day + b - 1524.5;
+		return true;
+	}
+
+	// What each thread reads, in catalog order within its chunk
+	struct Chunk {
+		std::vector<double> epoch;
+		std::vector<float> floats[8];
+		std::vector<char> designation;
+		size_t skipped = 0;
+	};
+
+	// One MPCORB line; columns are 1-based in the format description, so
+	// column n is line[n - 1]
+	bool readLine(const char* line, size_t length, Chunk& chunk) {
+		if (length < minimumLine) {
+			return false;
+		}
+		double epoch, M, peri, node, incl, e, n, a, H;
+		bool ok = readEpoch(line + 20, epoch)
+			&& readNumber(line + 26, line + 35, M)
+			&& readNumber(line + 37, line + 46, peri)
+			&& readNumber(line + 48, line + 57, node)
+			&& readNumber(line + 59, line + 68, incl)
+			&& readNumber(line + 70, line + 79, e)
+			&& readNumber(line + 80, line + 91, n)
+			&& readNumber(line + 92, line + 103, a)
+			&& e >= 0.0 && e < 1.0 && a > 0.0;
+		if (!ok) {
+			return false;
+		}
+		if (!readNumber(line + 8, line + 13, H)) {
+			H = std::numeric_limits<double>::quiet_NaN();
+		}
+
+		chunk.epoch.push_back(epoch);
+		float values[8] = { float(a), float(e), float(incl * degrees), float(node * degrees),
+			float(peri * degrees), float(M * degrees), float(n * degrees), float(H) };
+		for (int i = 0; i < 8; i++) {
+			chunk.floats[i].push_back(values[i]);
+		}
+		chunk.designation.insert(chunk.designation.end(), line, line + 7);
+		chunk.designation.push_back('\0');
+		return true;
+	}
+
+	void readChunk(const char* begin, const char* end, Chunk& chunk) {
+		// MPCORB lines are 203 bytes; a guess that avoids most regrowth
+		size_t expected = size_t(end - begin) / 200 + 16;
+		chunk.epoch.reserve(expected);
+		for (std::vector<float>& column : chunk.floats) {
+			column.reserve(expected);
+		}
+		chunk.designation.reserve(expected * 8);
+
+		while (begin < end) {
+			const char* newline = static_cast<const char*>(std::memchr(begin, '\n', size_t(end - begin)));
+			const char* lineEnd = newline ? newline : end;
+			size_t length = size_t(lineEnd - begin);
+			if (length > 0 && begin[length - 1] == '\r') {
+				length--;
+			}
+			if (!readLine(begin, length, chunk) && length > 0) {
+				chunk.skipped++;
+			}
+			begin = newline ? newline + 1 : end;
+		}
+	}
+
+	// Runs work(i) for i in [0, count) on a thread each
+	template <typename Work>
+	void parallel(size_t count, Work work) {
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < count; i++) {
+			threads.emplace_back(work, i);
+		}
+		work(size_t(0));
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+	}
+}
+
+
+MinorPlanetCatalog::MinorPlanetCatalog(const std::string& path)
+	: path(path)
+	, count(0)
+	, columns{}
+{
+	std::error_code error;
+	uint64_t sourceSize = std::filesystem::file_size(path, error);
+	if (error) {
+		Log::error("MINOR_PLANETS unable to open {}", path);
+		throw std::runtime_error("Failed to open minor planet catalog.");
+	}
+	int64_t sourceTime = int64_t(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+
+	std::string cachePath = path + ".bin";
+	mapping = BinaryCache::open<Header>(cachePath, magic, version, [&](const Header& cached, const MappedFile& file) {
+		return cached.sourceSize == sourceSize
+			&& cached.sourceTime == sourceTime
+			&& file.size() == layout(size_t(cached.count)).total;
+	});
+	if (mapping) {
+		point(mapping->data());
+		Log::info("MINOR_PLANETS {} objects from {}", count, cachePath);
+		return;
+	}
+
+	import(sourceSize, sourceTime);
+	BinaryCache::write(cachePath, imported, "MINOR_PLANETS");
+}
+
+
+void MinorPlanetCatalog::import(uint64_t sourceSize, int64_t sourceTime) {
+	auto start = std::chrono::steady_clock::now();
+	MappedFile source(path);
+	const char* begin = reinterpret_cast<const char*>(source.data());
+	const char* end = begin + source.size();
+
+	// MPCORB.DAT opens with a page of notes ending in a line of dashes;
+	// extracts like NEA.txt start straight with the data
+	const char* scanEnd = begin + std::min<size_t>(source.size(), 64 * 1024);
+	for (const char* line = begin; line < scanEnd; ) {
+		const char* newline = static_cast<const char*>(std::memchr(line, '\n', size_t(scanEnd - line)));
+		if (newline == nullptr) {
+			break;
+		}
+		if (newline - line >= 10 && std::memcmp(line, "----------", 10) == 0) {
+			begin = newline + 1;
+			break;
+		}
+		line = newline + 1;
+	}
+
+	// Split into line-aligned chunks; each boundary moves forward to the
+	// start of the next line
+	size_t threadCount = std::clamp<size_t>(size_t(end - begin) / minimumChunk, 1, std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<const char*> bounds(threadCount + 1, end);
+	bounds[0] = begin;
+	for (size_t i = 1; i < threadCount; i++) {
+		const char* bound = begin + size_t(end - begin) * i / threadCount;
+		const char* newline = static_cast<const char*>(std::memchr(bound, '\n', size_t(end - bound)));
+		bounds[i] = std::max(bounds[i - 1], newline ? newline + 1 : end);
+	}
+
+	std::vector<Chunk> chunks(threadCount);
+	parallel(threadCount, [&](size_t i) {
+		readChunk(bounds[i], bounds[i + 1], chunks[i]);
+	});
+
+	std::vector<size_t> firsts(threadCount + 1, 0);
+	size_t skipped = 0;
+	for (size_t i = 0; i < threadCount; i++) {
+		firsts[i + 1] = firsts[i] + chunks[i].epoch.size();
+		skipped += chunks[i].skipped;
+	}
+	count = firsts[threadCount];
+	if (count == 0) {
+		Log::error("MINOR_PLANETS {} has no objects in MPCORB format", path);
+		throw std::runtime_error("Invalid minor planet catalog.");
+	}
+
+	Layout l = layout(count);
+	imported.assign(l.total, 0);
+	Header header;
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.count = count;
+	header.sourceSize = sourceSize;
+	header.sourceTime = sourceTime;
+	std::memcpy(imported.data(), &header, sizeof(Header));
+
+	// Each thread copies its own rows into every column
+	parallel(threadCount, [&](size_t i) {
+		const Chunk& chunk = chunks[i];
+		unsigned char* out = imported.data();
+		std::memcpy(out + l.epoch + sizeof(double) * firsts[i], chunk.epoch.data(), sizeof(double) * chunk.epoch.size());
+		for (int c = 0; c < 8; c++) {
+			std::memcpy(out + l.floats[c] + sizeof(float) * firsts[i], chunk.floats[c].data(), sizeof(float) * chunk.floats[c].size());
+		}
+		std::memcpy(out + l.designation + 8 * firsts[i], chunk.designation.data(), chunk.designation.size());
+	});
+	point(imported.data());
+
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	Log::info("MINOR_PLANETS imported {} objects from {} on {} threads in {:.0f} ms", count, path, threadCount, milliseconds);
+	if (skipped > 0) {
+		Log::warn("MINOR_PLANETS skipped {} lines of {} that aren't MPCORB elements", skipped, path);
+	}
+}
+
+
+void MinorPlanetCatalog::point(const unsigned char* bytes) {
+	Header header;
+	std::memcpy(&header, bytes, sizeof(Header));
+	count = size_t(header.count);
+
+	Layout l = layout(count);
+	auto floats = [&](int column) { return reinterpret_cast<const float*>(bytes + l.floats[column]); };
+	columns.epoch = reinterpret_cast<const double*>(bytes + l.epoch);
+	columns.semiMajorAxis = floats(0);
+	columns.eccentricity = floats(1);
+	columns.inclination = floats(2);
+	columns.ascendingNode = floats(3);
+	columns.argumentOfPeriapsis = floats(4);
+	columns.meanAnomaly = floats(5);
+	columns.meanMotion = floats(6);
+	columns.absoluteMagnitude = floats(7);
+	columns.designation = reinterpret_cast<const char(*)[8]>(bytes + l.designation);
+}
+
+
+double MinorPlanetCatalog::latestEpoch() const {
+	return *std::max_element(columns.epoch, columns.epoch + count);
+}
+
+
+glm::dvec3 MinorPlanetCatalog::position(size_t i, double julianDate) const {
+	const Elements& c = columns;
+	double M = c.meanAnomaly[i] + double(c.meanMotion[i]) * (julianDate - c.epoch[i]);
+	return Kepler::position(c.semiMajorAxis[i], c.eccentricity[i], c.inclination[i], c.ascendingNode[i],
+		c.argumentOfPeriapsis[i], M);
+}
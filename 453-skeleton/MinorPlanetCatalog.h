@@ -0,0 +1,86 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains the minor planet catalog, read from MPCORB-format files.
+//
+// MPCORB.DAT (and the NEA/comet extracts in the same layout) has one fixed
+// width line per object, well over a million of them. The importer maps the
+// file, splits it into line-aligned chunks, one per thread, and reads the
+// columns in place without building strings. The elements end up in
+// structure-of-arrays tables, one column per element, which are written to
+// <path>.bin. Later loads map that file and point the tables straight into
+// it, as long as the size and modification time of the source still match.
+//
+// Elements are heliocentric, referred to the J2000 ecliptic and equinox, the
+// same frame as the star catalog. Angles are stored in radians.
+//------------------------------------------------------------------------------
+
+#include "MappedFile.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class MinorPlanetCatalog {
+
+public:
+	static constexpr char magic[4] = { 'O', 'M', 'P', 'C' };
+	static constexpr uint32_t version = 1;
+
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint64_t count;
+		uint64_t sourceSize;	// the source is considered unchanged while
+		int64_t sourceTime;		// these match it
+	};
+
+	static_assert(sizeof(Header) == 32, "MinorPlanetCatalog::Header must be packed");
+
+	// The columns, in the order they are stored after the header. Each one
+	// starts on an 8 byte boundary.
+	struct Elements {
+		const double* epoch;				// Julian date (TT) the elements hold at
+		const float* semiMajorAxis;			// AU
+		const float* eccentricity;
+		const float* inclination;
+		const float* ascendingNode;
+		const float* argumentOfPeriapsis;
+		const float* meanAnomaly;			// at epoch
+		const float* meanMotion;			// radians per day
+		const float* absoluteMagnitude;		// H, NaN where the catalog has none
+		const char (*designation)[8];		// packed as in the catalog, e.g. "00001  "
+	};
+
+	// Loads from the cache when it is current, imports and caches otherwise.
+	// Throws if the file can't be read or holds no objects.
+	explicit MinorPlanetCatalog(const std::string& path);
+
+	// Public interface
+	size_t size() const { return count; }
+	const Elements& elements() const { return columns; }
+	bool loadedFromCache() const { return mapping != nullptr; }
+
+	// Latest epoch in the catalog; MPCORB puts almost everything there
+	double latestEpoch() const;
+
+	// Heliocentric ecliptic position of one object at a Julian date, in AU,
+	// propagated as a two-body orbit from its epoch
+	glm::dvec3 position(size_t index, double julianDate) const;
+
+private:
+	std::string path;
+	size_t count;
+	Elements columns;
+
+	// One of these holds the tables
+	std::unique_ptr<MappedFile> mapping;
+	std::vector<unsigned char> imported;
+
+	void import(uint64_t sourceSize, int64_t sourceTime);
+	void point(const unsigned char* bytes);
+};
@@ -0,0 +1,82 @@
+#include "OrbitRenderer.h"
+
+#include "GLState.h"
+#include "RenderStats.h"
+
+#include <cstddef>
+
+
+OrbitRenderer::OrbitRenderer(int maxSegments)
+	: shader("shaders/orbit.vert", "shaders/orbit.frag")
+	, vao()
+	, instanceBuffer()
+	, uploadedEye(0.0)
+	, centersMoved(false)
+	, maxSegments(maxSegments)
+	, pixelsPerSegment(6.0f)
+{
+	// There are no per-vertex attributes at all, only per-instance ones
+	vao.bind();
+	GLState::bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, center));
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, eccentricity));
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, color));
+
+	for (GLuint i = 0; i < 3; i++) {
+		glEnableVertexAttribArray(i);
+		glVertexAttribDivisor(i, 1);
+	}
+}
+
+
+void OrbitRenderer::setOrbits(const std::vector<Orbit>& orbits) {
+	this->orbits = orbits;
+	instances.resize(orbits.size());
+	for (size_t i = 0; i < orbits.size(); i++) {
+		const Orbit& orbit = orbits[i];
+		instances[i] = Instance{ glm::vec3(orbit.center - uploadedEye), orbit.semiMajorAxis, orbit.eccentricity,
+			orbit.inclination, orbit.ascendingNode, orbit.argumentOfPeriapsis, orbit.color };
+	}
+	GLState::bufferData(instanceBuffer, sizeof(Instance) * instances.size(), instances.data(), GL_DYNAMIC_DRAW);
+}
+
+
+void OrbitRenderer::setCenter(size_t index, const glm::dvec3& center) {
+	if (orbits[index].center != center) {
+		orbits[index].center = center;
+		centersMoved = true;
+	}
+}
+
+
+void OrbitRenderer::draw(const glm::mat4& V, const glm::mat4& P, glm::ivec2 viewport, const glm::dvec3& eye) {
+	if (orbits.empty()) {
+		return;
+	}
+
+	// Centres can be far from the origin, so they are made relative to the
+	// eye in double before being narrowed to float
+	if (eye != uploadedEye || centersMoved) {
+		for (size_t i = 0; i < orbits.size(); i++) {
+			instances[i].center = glm::vec3(orbits[i].center - eye);
+		}
+		GLState::bufferSubData(instanceBuffer, 0, sizeof(Instance) * instances.size(), instances.data());
+		RenderStats::countUpload(sizeof(Instance) * instances.size());
+		uploadedEye = eye;
+		centersMoved = false;
+	}
+
+	shader.use();
+	glUniformMatrix4fv(glGetUniformLocation(shader, "V"), 1, GL_FALSE, &V[0][0]);
+	glUniformMatrix4fv(glGetUniformLocation(shader, "P"), 1, GL_FALSE, &P[0][0]);
+	glUniform2f(glGetUniformLocation(shader, "viewport"), float(viewport.x), float(viewport.y));
+	glUniform1i(glGetUniformLocation(shader, "maxSegments"), maxSegments);
+	glUniform1f(glGetUniformLocation(shader, "pixelsPerSegment"), pixelsPerSegment);
+
+	// maxSegments + 1 vertices closes the loop. Orbits that need fewer
+	// segments collapse their surplus vertices onto the closing point.
+	vao.bind();
+	glDrawArraysInstanced(GL_LINE_STRIP, 0, maxSegments + 1, GLsizei(instances.size()));
+	RenderStats::countDraw(maxSegments + 1, GLsizei(instances.size()));
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a renderer for orbit paths.
+//
+// Each orbit is a single instance of Keplerian elements. The vertex shader
+// turns gl_VertexID into an eccentric anomaly and places the vertex on the
+// ellipse, so no polyline ever exists on the CPU and drawing every orbit is a
+// single instanced call. Only the centres, rebased on the eye in double
+// precision, are uploaded again when the camera or a centre moves.
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+#include "ShaderProgram.h"
+#include "VertexArray.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+class OrbitRenderer {
+
+public:
+	// Angles are in radians and the reference plane is the xy plane
+	struct Orbit {
+		glm::dvec3 center;
+		float semiMajorAxis;
+		float eccentricity;
+		float inclination;
+		float ascendingNode;
+		float argumentOfPeriapsis;
+		glm::vec3 color;
+	};
+
+	explicit OrbitRenderer(int maxSegments = 512);
+
+	// Public interface
+	void setOrbits(const std::vector<Orbit>& orbits);
+
+	// For orbits about a body that moves; uploaded with the next draw
+	void setCenter(size_t index, const glm::dvec3& center);
+
+	// V is camera-relative; eye is the camera position the world is rebased on
+	void draw(const glm::mat4& V, const glm::mat4& P, glm::ivec2 viewport, const glm::dvec3& eye);
+
+	// Roughly how many pixels of orbit each line segment should cover. Orbits
+	// that are small on screen get fewer segments, capped at maxSegments.
+	void setPixelsPerSegment(float pixels) { pixelsPerSegment = pixels; }
+
+private:
+	// Per-instance data, laid out exactly as it is uploaded to the GPU
+	struct Instance {
+		glm::vec3 center;	// relative to the eye
+		float semiMajorAxis;
+		float eccentricity;
+		float inclination;
+		float ascendingNode;
+		float argumentOfPeriapsis;
+		glm::vec3 color;
+	};
+
+	ShaderProgram shader;
+
+	// note: due to how OpenGL works, vao needs to be
+	// defined and initialized before the instance buffer
+	VertexArray vao;
+	VertexBufferHandle instanceBuffer;
+
+	std::vector<Orbit> orbits;
+	std::vector<Instance> instances;
+	glm::dvec3 uploadedEye;
+	bool centersMoved;
+
+	int maxSegments;
+	float pixelsPerSegment;
+};
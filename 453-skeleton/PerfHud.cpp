@@ -0,0 +1,83 @@
+#include "PerfHud.h"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <cfloat>
+
+
+namespace {
+	const int histogramBins = 32;
+
+	ImVec2 plotSize(float height) {
+		return ImVec2(ImGui::GetContentRegionAvail().x, height);
+	}
+}
+
+
+PerfHud::PerfHud(int windowSize)
+	: frameTimes(windowSize, 0.0f)
+	, next(0)
+	, filled(0)
+	, last()
+	, messages()
+{}
+
+
+void PerfHud::addFrame(float milliseconds, const RenderStats::Counters& counters) {
+	frameTimes[next] = milliseconds;
+	next = (next + 1) % int(frameTimes.size());
+	filled = std::min(filled + 1, int(frameTimes.size()));
+	last = counters;
+}
+
+
+float PerfHud::percentile(float p) const {
+	if (filled == 0) {
+		return 0.0f;
+	}
+
+	// Only the first filled entries are valid until the ring wraps
+	std::vector<float> sorted(frameTimes.begin(), frameTimes.begin() + filled);
+	size_t rank = size_t(p * float(filled - 1) + 0.5f);
+	std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+	return sorted[rank];
+}
+
+
+void PerfHud::draw(bool* visible) {
+	ImGui::SetNextWindowSize(ImVec2(360, 0), ImGuiCond_FirstUseEver);
+	if (!ImGui::Begin("Performance", visible)) {
+		ImGui::End();
+		return;
+	}
+
+	float p50 = percentile(0.50f);
+	float p95 = percentile(0.95f);
+	float p99 = percentile(0.99f);
+	ImGui::Text("p50 %.2f ms   p95 %.2f ms   p99 %.2f ms", p50, p95, p99);
+	ImGui::Text("over the last %d frames (%.0f fps median)", filled, p50 > 0.0f ? 1000.0f / p50 : 0.0f);
+
+	// Oldest first; before the ring wraps that is simply the start
+	int offset = filled == int(frameTimes.size()) ? next : 0;
+	float ceiling = std::max(p99 * 1.25f, 1.0f);
+	ImGui::PlotLines("##frametimes", frameTimes.data(), filled, offset, "frame time", 0.0f, ceiling, plotSize(60.0f));
+
+	float bins[histogramBins] = {};
+	for (int i = 0; i < filled; i++) {
+		int bin = std::min(int(frameTimes[i] / ceiling * histogramBins), histogramBins - 1);
+		bins[bin] += 1.0f;
+	}
+	ImGui::PlotHistogram("##histogram", bins, histogramBins, 0, "distribution", 0.0f, FLT_MAX, plotSize(60.0f));
+	ImGui::Text("bins span 0 to %.1f ms", ceiling);
+
+	ImGui::Separator();
+	ImGui::Text("draw calls     %llu", (unsigned long long)last.drawCalls);
+	ImGui::Text("vertices       %llu", (unsigned long long)last.vertices);
+	ImGui::Text("bytes uploaded %llu", (unsigned long long)last.bytesUploaded);
+	ImGui::Text("texture binds  %llu", (unsigned long long)last.textureBinds);
+	ImGui::Text("state changes  %llu (%llu skipped)", (unsigned long long)last.stateChanges, (unsigned long long)last.stateSkipped);
+	ImGui::Text("gl messages    %u (%u high, %u repeats hidden)", messages.total(), messages.high, messages.suppressed);
+
+	ImGui::End();
+}
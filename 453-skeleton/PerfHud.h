@@ -0,0 +1,38 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains an ImGui performance overlay.
+//
+// It keeps a sliding window of frame times and shows them as a history plot,
+// a histogram and p50/p95/p99, next to the render counters and GL debug
+// message counts of the last frame.
+//------------------------------------------------------------------------------
+
+#include "GLDebug.h"
+#include "RenderStats.h"
+
+#include <vector>
+
+
+class PerfHud {
+
+public:
+	explicit PerfHud(int windowSize = 240);
+
+	// Public interface
+	void addFrame(float milliseconds, const RenderStats::Counters& counters);
+	void setDebugMessages(const GLDebug::FrameStats& stats) { messages = stats; }
+	void draw(bool* visible);
+
+	// p in [0, 1], over the frames currently in the window
+	float percentile(float p) const;
+
+private:
+	// Ring of the last windowSize frame times, oldest at next once full
+	std::vector<float> frameTimes;
+	int next;
+	int filled;
+
+	RenderStats::Counters last;
+	GLDebug::FrameStats messages;
+};
@@ -0,0 +1,167 @@
+#include "Profiler.h"
+
+#include "Log.h"
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+	// Finished zones kept per thread. At a few dozen zones a frame this is
+	// well over a minute of history.
+	const size_t ringSize = 1 << 16;
+
+	// Deepest nesting tracked; deeper zones are timed but not recorded
+	const int maxDepth = 64;
+
+	struct Event {
+		const char* name;
+		int64_t start;	// nanoseconds since startup
+		int64_t end;
+	};
+
+	struct ThreadBuffer {
+		uint32_t id;
+		std::string name;
+
+		// Written only by the owning thread. head is published with release
+		// ordering after each event, so writeTrace sees complete events.
+		std::vector<Event> events;
+		std::atomic<uint64_t> head{ 0 };
+
+		// Open zones, only ever touched by the owning thread
+		const char* openNames[maxDepth];
+		int64_t openStarts[maxDepth];
+		int depth = 0;
+	};
+
+	const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+	// Buffers are never freed so a trace can include threads that have exited
+	std::mutex registryMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> registry;
+
+	std::atomic<bool> gpuMarkers{ false };
+	std::thread::id glThread;
+
+	int64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	ThreadBuffer& localBuffer() {
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (buffer == nullptr) {
+			std::lock_guard<std::mutex> lock(registryMutex);
+			registry.push_back(std::make_unique<ThreadBuffer>());
+			buffer = registry.back().get();
+			buffer->id = uint32_t(registry.size());
+			buffer->events.resize(ringSize);
+		}
+		return *buffer;
+	}
+
+	// Names come from source code, but escape them anyway so the JSON is valid
+	std::string escape(const std::string& text) {
+		std::string escaped;
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				escaped += '\\';
+			}
+			escaped += c;
+		}
+		return escaped;
+	}
+}
+
+
+void Profiler::enableGpuMarkers() {
+	if (!GLEW_KHR_debug) {
+		Log::info("PROFILER KHR_debug unavailable, zones won't appear as GL debug groups");
+		return;
+	}
+	glThread = std::this_thread::get_id();
+	gpuMarkers = true;
+}
+
+
+bool Profiler::gpuMarkersOnThisThread() {
+	return gpuMarkers.load(std::memory_order_relaxed) && std::this_thread::get_id() == glThread;
+}
+
+
+void Profiler::setThreadName(const std::string& name) {
+	ThreadBuffer& buffer = localBuffer();
+	std::lock_guard<std::mutex> lock(registryMutex);
+	buffer.name = name;
+}
+
+
+void Profiler::beginZone(const char* name) {
+	ThreadBuffer& buffer = localBuffer();
+	if (buffer.depth < maxDepth) {
+		buffer.openNames[buffer.depth] = name;
+		buffer.openStarts[buffer.depth] = now();
+	}
+	buffer.depth++;
+}
+
+
+void Profiler::endZone() {
+	ThreadBuffer& buffer = localBuffer();
+	buffer.depth--;
+	if (buffer.depth >= maxDepth) {
+		return;
+	}
+
+	uint64_t head = buffer.head.load(std::memory_order_relaxed);
+	buffer.events[head % ringSize] = { buffer.openNames[buffer.depth], buffer.openStarts[buffer.depth], now() };
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+
+bool Profiler::writeTrace(const std::string& path) {
+	std::ofstream file(path);
+	if (!file) {
+		Log::error("PROFILER unable to write {}", path);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	// Trace event timestamps are in microseconds
+	size_t written = 0;
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	for (const auto& buffer : registry) {
+		if (!buffer->name.empty()) {
+			file << (written++ ? ",\n" : "") << fmt::format(
+				"{{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+				buffer->id, escape(buffer->name)
+			);
+		}
+
+		// Other threads keep recording while this runs. Skipping the oldest
+		// quarter of a full ring keeps clear of the slots being overwritten.
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+		uint64_t first = head > ringSize ? head - ringSize + ringSize / 4 : 0;
+		for (uint64_t i = first; i < head; i++) {
+			const Event& event = buffer->events[i % ringSize];
+			file << (written++ ? ",\n" : "") << fmt::format(
+				"{{\"ph\":\"X\",\"name\":\"{}\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+				escape(event.name), buffer->id, double(event.start) * 1e-3, double(event.end - event.start) * 1e-3
+			);
+		}
+	}
+	file << "\n]}\n";
+
+	Log::info("PROFILER wrote {} events to {}", written, path);
+	return true;
+}
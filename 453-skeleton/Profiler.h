@@ -0,0 +1,70 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a scoped-zone CPU profiler.
+//
+// Zones are recorded with the PROFILE_ZONE macro, which times the enclosing
+// scope. Every thread writes into its own fixed-size ring of finished zones,
+// so recording never takes a lock; only a thread's first zone registers its
+// ring. writeTrace() dumps every ring as Chrome trace-event JSON, which opens
+// in chrome://tracing and ui.perfetto.dev.
+//
+// Zones recorded on the GL thread are also pushed as debug groups, so they
+// show up in RenderDoc, apitrace and friends.
+//
+// Building with ORRERY_PROFILING=0 turns PROFILE_ZONE into nothing.
+//
+// Example:
+//		void update() {
+//			PROFILE_ZONE("sim");
+//			...
+//		}
+//------------------------------------------------------------------------------
+
+#include "GLDebug.h"
+
+#include <string>
+
+#ifndef ORRERY_PROFILING
+#define ORRERY_PROFILING 1
+#endif
+
+
+namespace Profiler {
+
+	// Call on the thread that owns the GL context, after GLEW is initialized.
+	// Zones from that thread are then mirrored into glPushDebugGroup.
+	void enableGpuMarkers();
+	bool gpuMarkersOnThisThread();
+
+	// Shown instead of the numeric thread id in trace viewers
+	void setThreadName(const std::string& name);
+
+	void beginZone(const char* name);
+	void endZone();
+
+	bool writeTrace(const std::string& path);
+
+	// name must outlive the profiler; string literals are the intended use
+	class Zone {
+	public:
+		explicit Zone(const char* name) : marker(name, gpuMarkersOnThisThread()) { beginZone(name); }
+		~Zone() { endZone(); }
+
+		Zone(const Zone&) = delete;
+		Zone operator=(const Zone&) = delete;
+
+	private:
+		GLDebug::Group marker;
+	};
+}
+
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if ORRERY_PROFILING
+#define PROFILE_ZONE(name) Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
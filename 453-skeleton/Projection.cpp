@@ -0,0 +1,67 @@
+#include "Projection.h"
+
+#include "Log.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+
+namespace {
+	bool reversedZ = false;
+}
+
+
+bool Projection::enableReversedZ() {
+	if (GLEW_VERSION_4_5 || GLEW_ARB_clip_control) {
+		glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+		reversedZ = true;
+		Log::info("PROJECTION using reversed-Z with an infinite far plane");
+	}
+	else {
+		reversedZ = false;
+		Log::warn("PROJECTION glClipControl unavailable, using conventional depth");
+	}
+	return reversedZ;
+}
+
+
+bool Projection::isReversedZ() {
+	return reversedZ;
+}
+
+
+glm::mat4 Projection::perspective(float fovy, float aspect, float zNear) {
+	if (!reversedZ) {
+		return glm::infinitePerspective(fovy, aspect, zNear);
+	}
+
+	// depth = zNear / -z_eye: 1 at the near plane, approaching 0 at infinity
+	float f = 1.0f / std::tan(fovy / 2.0f);
+	glm::mat4 P(0.0f);
+	P[0][0] = f / aspect;
+	P[1][1] = f;
+	P[2][3] = -1.0f;
+	P[3][2] = zNear;
+	return P;
+}
+
+
+GLenum Projection::depthFunc() {
+	return reversedZ ? GL_GREATER : GL_LESS;
+}
+
+
+GLenum Projection::depthFuncOrEqual() {
+	return reversedZ ? GL_GEQUAL : GL_LEQUAL;
+}
+
+
+float Projection::clearDepth() {
+	return reversedZ ? 0.0f : 1.0f;
+}
+
+
+float Projection::farPlane() {
+	return reversedZ ? 0.0f : 1.0f;
+}
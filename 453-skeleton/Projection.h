@@ -0,0 +1,37 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Depth conventions for the whole renderer.
+//
+// With reversed-Z, the near plane maps to depth 1 and infinity to depth 0.
+// Combined with a floating point depth buffer this spreads precision evenly
+// enough in log space to draw planet surfaces and AU distances in one pass.
+// It needs glClipControl (GL 4.5 or ARB_clip_control) for a [0, 1] clip
+// range; without it we fall back to the conventional mapping.
+//
+// Both conventions use an infinite far plane, so nothing is ever clipped for
+// being too far away.
+//------------------------------------------------------------------------------
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+
+namespace Projection {
+
+	// Switches to reversed-Z if the context supports it. Returns whether it did.
+	bool enableReversedZ();
+	bool isReversedZ();
+
+	glm::mat4 perspective(float fovy, float aspect, float zNear);
+
+	// Depth tests for ordinary geometry, and for geometry placed exactly on
+	// the far plane (skybox, stars)
+	GLenum depthFunc();
+	GLenum depthFuncOrEqual();
+
+	float clearDepth();
+
+	// Clip-space z/w of the far plane, for shaders that push vertices to infinity
+	float farPlane();
+}
@@ -0,0 +1,127 @@
+#include "RenderQueue.h"
+
+#include "GLState.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+
+namespace {
+
+	const uint64_t idMask = 0x3ff;
+
+	// Non-negative IEEE floats order the same as their bit patterns
+	uint64_t depthBits(float depth) {
+		if (!(depth > 0.0f)) {
+			return 0;
+		}
+		uint32_t bits;
+		std::memcpy(&bits, &depth, sizeof(bits));
+		return bits;
+	}
+}
+
+
+uint64_t RenderQueue::makeKey(Pass pass, GLuint program, GLuint texture, GLuint mesh, float depth) {
+	uint64_t state = ((program & idMask) << 20) | ((texture & idMask) << 10) | (mesh & idMask);
+	uint64_t key = uint64_t(pass) << 62;
+
+	// pass:2 | ~depth:32 | state:30, back to front
+	if (pass == Pass::Transparent) {
+		return key | ((~depthBits(depth) & 0xffffffff) << 30) | state;
+	}
+
+	// pass:2 | state:30 | depth:32, front to back
+	return key | (state << 32) | depthBits(depth);
+}
+
+
+void RenderQueue::submit(Packet packet) {
+	entries.push_back({ packet.key, uint32_t(packets.size()) });
+	packets.push_back(std::move(packet));
+}
+
+
+void RenderQueue::execute(GpuProfiler* profiler) {
+	{
+		PROFILE_ZONE("sort");
+		sort();
+	}
+
+	const char* pass = nullptr;
+	for (const Entry& entry : entries) {
+		const Packet& packet = packets[entry.index];
+		if (profiler != nullptr && packet.name != nullptr && (pass == nullptr || std::strcmp(pass, packet.name) != 0)) {
+			profiler->begin(packet.name);
+			pass = packet.name;
+		}
+		run(packet);
+	}
+	if (profiler != nullptr && pass != nullptr) {
+		profiler->end();
+	}
+
+	packets.clear();
+	entries.clear();
+}
+
+
+void RenderQueue::sort() {
+	// LSD radix sort, a byte at a time. It is stable, so equal keys keep
+	// their submission order and frames stay deterministic.
+	size_t n = entries.size();
+	if (n < 2) {
+		return;
+	}
+	scratch.resize(n);
+
+	for (int shift = 0; shift < 64; shift += 8) {
+		size_t counts[256] = {};
+		for (const Entry& entry : entries) {
+			counts[(entry.key >> shift) & 0xff]++;
+		}
+
+		// Every key has the same byte here; most do, e.g. the pass bits
+		if (counts[(entries[0].key >> shift) & 0xff] == n) {
+			continue;
+		}
+
+		size_t offset = 0;
+		for (size_t& count : counts) {
+			size_t c = count;
+			count = offset;
+			offset += c;
+		}
+		for (const Entry& entry : entries) {
+			scratch[counts[(entry.key >> shift) & 0xff]++] = entry;
+		}
+		entries.swap(scratch);
+	}
+}
+
+
+void RenderQueue::run(const Packet& packet) {
+	if (packet.custom) {
+		packet.custom(packet.context);
+		return;
+	}
+
+	GLState::useProgram(packet.program);
+	GLState::bindVertexArray(packet.vertexArray);
+	if (packet.texture != 0) {
+		GLState::bindTexture(0, packet.textureTarget, packet.texture);
+	}
+	if (packet.uniformSize > 0) {
+		GLState::bindBufferRange(GL_UNIFORM_BUFFER, 0, packet.uniformBuffer, packet.uniformOffset, packet.uniformSize);
+	}
+
+	if (packet.instances > 1) {
+		glDrawArraysInstanced(packet.mode, packet.first, packet.count, packet.instances);
+	} else {
+		glDrawArrays(packet.mode, packet.first, packet.count);
+	}
+	RenderStats::countDraw(packet.count, packet.instances);
+}
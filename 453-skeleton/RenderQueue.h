@@ -0,0 +1,91 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a sorted queue of draw packets.
+//
+// Renderables submit packets instead of drawing straight away. Each packet
+// carries a 64-bit key packed from its pass, program, texture, mesh and
+// depth; once per frame the keys are radix sorted and the packets executed
+// in key order through GLState, so equal state ends up adjacent and is
+// only set once. Within opaque state, packets go front to back for early-Z;
+// transparent packets sort by depth first, back to front.
+//
+// Program, texture and mesh names only take 10 bits each. Larger names
+// share buckets with smaller ones, which affects order, never correctness:
+// every packet still binds its own full names.
+//
+// Example:
+//		RenderQueue::Packet packet;
+//		packet.key = RenderQueue::makeKey(RenderQueue::Pass::Opaque, program, texture, vao, distance);
+//		... fill in the draw ...
+//		queue.submit(std::move(packet));
+//		queue.execute(&profiler);
+//------------------------------------------------------------------------------
+
+#include "GpuProfiler.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <vector>
+
+
+class RenderQueue {
+
+public:
+	// Executed in this order
+	enum class Pass : uint8_t {
+		Opaque,
+		Background,		// at the far plane, behind everything opaque
+		Transparent,
+		Overlay,
+	};
+
+	struct Packet {
+		uint64_t key = 0;
+		const char* name = nullptr;		// GPU profiler pass, if any
+
+		// A packet either describes a plain draw...
+		GLuint program = 0;
+		GLuint vertexArray = 0;
+		GLenum textureTarget = GL_TEXTURE_2D;
+		GLuint texture = 0;
+		GLuint uniformBuffer = 0;		// bound to uniform block 0 when set
+		GLintptr uniformOffset = 0;
+		GLsizeiptr uniformSize = 0;
+		GLenum mode = GL_TRIANGLES;
+		GLint first = 0;
+		GLsizei count = 0;
+		GLsizei instances = 1;
+
+		// ...or hands over to a renderer that draws itself. A plain function
+		// pointer and context, so submitting a packet never allocates.
+		void (*custom)(void* context) = nullptr;
+		void* context = nullptr;
+	};
+
+	// Depth is the view distance; negative and NaN count as zero
+	static uint64_t makeKey(Pass pass, GLuint program, GLuint texture, GLuint mesh, float depth);
+
+	// Public interface
+	void submit(Packet packet);
+
+	// Sorts and runs everything submitted, then empties the queue. Storage is
+	// kept, so a steady scene doesn't allocate.
+	void execute(GpuProfiler* profiler = nullptr);
+
+	size_t size() const { return packets.size(); }
+
+private:
+	struct Entry {
+		uint64_t key;
+		uint32_t index;
+	};
+
+	std::vector<Packet> packets;
+	std::vector<Entry> entries;
+	std::vector<Entry> scratch;
+
+	void sort();
+	void run(const Packet& packet);
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Per-frame render counters.
+//
+// The GL wrappers count their own work as they issue it (draws in
+// GPU_Geometry and the renderers, uploads in VertexBuffer and StreamBuffer,
+// binds and state changes in GLState), so the numbers are exact rather
+// than estimated. stateSkipped counts requests GLState found redundant.
+// Counting is single-threaded, like the GL calls it mirrors.
+//
+// Example:
+//		RenderStats::Counters last = RenderStats::nextFrame();
+//		Log::info("{} draw calls", last.drawCalls);
+//------------------------------------------------------------------------------
+
+#include <GL/glew.h>
+
+#include <cstdint>
+
+
+namespace RenderStats {
+
+	struct Counters {
+		uint64_t drawCalls = 0;
+		uint64_t vertices = 0;
+		uint64_t bytesUploaded = 0;
+		uint64_t textureBinds = 0;
+		uint64_t stateChanges = 0;
+		uint64_t stateSkipped = 0;
+	};
+
+	// The frame currently being recorded
+	inline Counters current;
+
+	inline void countDraw(GLsizei vertexCount, GLsizei instanceCount = 1) {
+		current.drawCalls++;
+		current.vertices += uint64_t(vertexCount) * uint64_t(instanceCount);
+	}
+
+	inline void countUpload(GLsizeiptr bytes) {
+		current.bytesUploaded += uint64_t(bytes);
+	}
+
+	inline void countTextureBind() {
+		current.textureBinds++;
+	}
+
+	inline void countStateChange() {
+		current.stateChanges++;
+	}
+
+	inline void countStateSkipped() {
+		current.stateSkipped++;
+	}
+
+	// Returns the counters of the frame just finished and starts a new one
+	inline Counters nextFrame() {
+		Counters finished = current;
+		current = Counters();
+		return finished;
+	}
+}
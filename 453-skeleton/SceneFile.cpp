@@ -0,0 +1,252 @@
+#include "SceneFile.h"
+
+#include "BinaryCache.h"
+#include "Ephemeris.h"
+#include "Log.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+
+namespace {
+
+	// FNV-1a; only has to notice edits, not resist them
+	uint64_t hashBytes(const std::string& bytes) {
+		uint64_t hash = 14695981039346656037ull;
+		for (unsigned char c : bytes) {
+			hash = (hash ^ c) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool readFile(const std::string& path, std::string& contents) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file) {
+			return false;
+		}
+		std::ostringstream stream;
+		stream << file.rdbuf();
+		contents = stream.str();
+		return true;
+	}
+}
+
+
+SceneFile::SceneFile(const std::string& path)
+	: path(path)
+{
+	std::string source;
+	if (!readFile(path, source)) {
+		Log::error("SCENE unable to open {}", path);
+		throw std::runtime_error("Failed to open scene.");
+	}
+	uint64_t hash = hashBytes(source);
+
+	std::string cachePath = path + ".bin";
+	mapping = BinaryCache::open<Header>(cachePath, magic, version, [hash](const Header& cached, const MappedFile& file) {
+		return cached.sourceHash == hash
+			&& file.size() == sizeof(Header) + size_t(cached.bodyCount) * sizeof(BodyRecord) + cached.stringBytes
+			&& consistent(cached, file.data());
+	});
+	if (mapping) {
+		Log::info("SCENE {} bodies from {}", size(), cachePath);
+		return;
+	}
+
+	compile(source, hash);
+	if (BinaryCache::write(cachePath, compiled, "SCENE")) {
+		Log::info("SCENE compiled {} bodies from {} into {}", size(), path, cachePath);
+	}
+}
+
+
+// The records are used without further checks, so a cache that was damaged
+// or edited by hand must not get past here
+bool SceneFile::consistent(const Header& cached, const unsigned char* bytes) {
+	const BodyRecord* bodies = reinterpret_cast<const BodyRecord*>(bytes + sizeof(Header));
+	const char* strings = reinterpret_cast<const char*>(bodies + cached.bodyCount);
+	if (cached.bodyCount == 0 || cached.stringBytes == 0 || strings[cached.stringBytes - 1] != '\0') {
+		return false;
+	}
+
+	int32_t count = int32_t(cached.bodyCount);
+	for (int32_t i = 0; i < count; i++) {
+		const BodyRecord& body = bodies[i];
+		bool ok = body.name < cached.stringBytes
+			&& body.texture != 0 && body.texture < cached.stringBytes
+			&& body.parent >= -1 && body.parent < i
+			&& body.revolvesAbout >= -1 && body.revolvesAbout < count && body.revolvesAbout != i
+			&& body.ephemeris >= -1 && body.ephemeris < int32_t(Ephemeris::bodyCount);
+		if (!ok) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+void SceneFile::compile(const std::string& source, uint64_t hash) {
+	std::vector<BodyRecord> bodies;
+	std::string strings(1, '\0');	// offset 0 is the empty string
+	std::map<std::string, int32_t> indices;
+
+	// revolves may name bodies further down, so those are resolved at the end
+	std::vector<std::pair<size_t, std::string>> revolves;
+	std::vector<int> revolvesLines;
+	std::vector<int> bodyLines;
+
+	auto intern = [&strings](const std::string& text) {
+		uint32_t offset = uint32_t(strings.size());
+		strings.append(text).push_back('\0');
+		return offset;
+	};
+	auto fail = [this](int lineNumber, const std::string& line) {
+		Log::error("SCENE {}:{} can't parse \"{}\"", path, lineNumber, line);
+		throw std::runtime_error("Invalid scene.");
+	};
+
+	std::istringstream lines(source);
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(lines, line)) {
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream words(line);
+		std::string command;
+		if (!(words >> command)) {
+			continue;
+		}
+
+		if (command == "body") {
+			std::string name;
+			if (!(words >> name) || indices.count(name)) {
+				fail(lineNumber, line);
+			}
+			BodyRecord body{};
+			body.name = intern(name);
+			body.parent = -1;
+			body.revolvesAbout = -1;
+			body.radius = 1.0f;
+			body.ambient = 0.12f;
+			body.ephemeris = -1;
+			body.ephemerisScale = 1.0f;
+			indices[name] = int32_t(bodies.size());
+			bodies.push_back(body);
+			bodyLines.push_back(lineNumber);
+			continue;
+		}
+		if (bodies.empty()) {
+			fail(lineNumber, line);
+		}
+
+		BodyRecord& body = bodies.back();
+		bool ok;
+		if (command == "parent") {
+			std::string name;
+			ok = bool(words >> name) && indices.count(name) && indices[name] != int32_t(bodies.size() - 1);
+			if (ok) {
+				body.parent = indices[name];
+			}
+		}
+		else if (command == "texture") {
+			std::string texture;
+			ok = bool(words >> texture);
+			body.texture = intern(texture);
+		}
+		else if (command == "filter") {
+			std::string filter;
+			ok = bool(words >> filter) && (filter == "linear" || filter == "nearest");
+			if (filter == "nearest") {
+				body.flags |= NearestFilter;
+			}
+		}
+		else if (command == "radius") {
+			ok = bool(words >> body.radius) && body.radius > 0.0f;
+		}
+		else if (command == "place") {
+			ok = bool(words >> body.distance >> body.pitch >> body.yaw);
+			body.flags &= ~uint32_t(HasElements);
+		}
+		else if (command == "elements") {
+			float* e = body.elements;
+			ok = bool(words >> e[0] >> e[1] >> e[2] >> e[3] >> e[4] >> e[5]) && e[0] > 0.0f && e[1] >= 0.0f && e[1] < 1.0f;
+			body.flags |= HasElements;
+		}
+		else if (command == "spin") {
+			ok = bool(words >> body.spin);
+		}
+		else if (command == "revolves") {
+			std::string name;
+			ok = bool(words >> name);
+			revolves.emplace_back(bodies.size() - 1, name);
+			revolvesLines.push_back(lineNumber);
+		}
+		else if (command == "orbit_path") {
+			float* c = body.orbitColor;
+			ok = bool(words >> c[0] >> c[1] >> c[2]);
+			body.flags |= HasOrbitPath;
+		}
+		else if (command == "ambient") {
+			ok = bool(words >> body.ambient);
+		}
+		else if (command == "ephemeris") {
+			std::string name;
+			Ephemeris::Body target = Ephemeris::Body::Sun;
+			ok = bool(words >> name) && Ephemeris::bodyFromName(name, target);
+			body.ephemeris = int32_t(target);
+			if (ok && !(words >> body.ephemerisScale)) {
+				body.ephemerisScale = 1.0f;
+			}
+		}
+		else if (command == "spk") {
+			ok = bool(words >> body.naifId);
+			body.flags |= FollowsSpk;
+			if (ok && !(words >> body.ephemerisScale)) {
+				body.ephemerisScale = 1.0f;
+			}
+		}
+		else {
+			ok = false;
+		}
+
+		if (!ok) {
+			fail(lineNumber, line);
+		}
+	}
+
+	for (size_t i = 0; i < revolves.size(); i++) {
+		auto found = indices.find(revolves[i].second);
+		if (found == indices.end() || size_t(found->second) == revolves[i].first) {
+			fail(revolvesLines[i], "revolves " + revolves[i].second);
+		}
+		bodies[revolves[i].first].revolvesAbout = found->second;
+	}
+	// Every body is drawn with its texture, there's no untextured material
+	for (size_t i = 0; i < bodies.size(); i++) {
+		if (bodies[i].texture == 0) {
+			fail(bodyLines[i], "body " + std::string(strings.data() + bodies[i].name) + " (no texture)");
+		}
+	}
+	if (bodies.empty()) {
+		Log::error("SCENE {} has no bodies", path);
+		throw std::runtime_error("Invalid scene.");
+	}
+
+	Header header;
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.sourceHash = hash;
+	header.bodyCount = uint32_t(bodies.size());
+	header.stringBytes = uint32_t(strings.size());
+
+	compiled.resize(sizeof(Header) + sizeof(BodyRecord) * bodies.size() + strings.size());
+	unsigned char* out = compiled.data();
+	std::memcpy(out, &header, sizeof(Header));
+	std::memcpy(out + sizeof(Header), bodies.data(), sizeof(BodyRecord) * bodies.size());
+	std::memcpy(out + sizeof(Header) + sizeof(BodyRecord) * bodies.size(), strings.data(), strings.size());
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains the scene description and its compiled binary cache.
+//
+// Scenes are written as text, one body after another:
+//
+//		body earth				starts a body; bodies are numbered in file order
+//		parent sun				placed relative to an earlier body
+//		texture textures/earth.png	required
+//		filter linear			or nearest
+//		radius 0.017			scale of the unit sphere mesh
+//		place 1.0 -25 -25		distance, pitch and yaw (radians) from the parent
+//		elements a e i node periapsis anomaly
+//								or Keplerian elements around the parent,
+//								angles in radians, reference plane xy; the
+//								anomaly advances when orbits run
+//		spin 1					axial rotation rate, 0 for none
+//		revolves sun			body it revolves about when orbits run,
+//								unless placed by elements
+//		orbit_path 0.3 0.5 1.0	draws its orbit in this colour, unless it
+//								follows an ephemeris or spk
+//		ambient 0.12			material: light it receives with no sun
+//		ephemeris earth 1		follows this body of the ephemeris given with
+//								--ephemeris, its offset from the parent's
+//								ephemeris body (or the Sun) scaled by the
+//								optional factor; place and elements still
+//								apply when no ephemeris is loaded
+//		spk 301 150				the same for a NAIF body id in the kernels
+//								given with --spk
+//
+// The first load compiles the text into a header, a packed array of
+// BodyRecords and a string table, written next to the source as <path>.bin.
+// Later loads map that file and use it in place as long as the hash of the
+// source still matches, so even scenes with thousands of bodies skip parsing.
+//------------------------------------------------------------------------------
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class SceneFile {
+
+public:
+	static constexpr char magic[4] = { 'O', 'S', 'C', 'N' };
+	static constexpr uint32_t version = 4;
+
+	enum Flags : uint32_t {
+		HasElements = 1,		// placed by elements rather than place
+		HasOrbitPath = 2,
+		NearestFilter = 4,
+		FollowsSpk = 8,			// naifId is set
+	};
+
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceHash;
+		uint32_t bodyCount;
+		uint32_t stringBytes;
+	};
+
+	struct BodyRecord {
+		uint32_t name;			// offsets into the string table
+		uint32_t texture;
+		int32_t parent;			// index of an earlier body, or -1
+		int32_t revolvesAbout;	// index of any body, or -1
+		uint32_t flags;
+		float radius;
+		float distance;
+		float pitch;
+		float yaw;
+		float elements[6];		// a, e, i, node, periapsis, mean anomaly
+		float spin;
+		float ambient;
+		float orbitColor[3];
+		int32_t ephemeris;		// Ephemeris::Body, or -1
+		float ephemerisScale;	// for both ephemeris and spk
+		int32_t naifId;
+		uint32_t padding;
+	};
+
+	static_assert(sizeof(Header) == 24, "SceneFile::Header must be packed");
+	static_assert(sizeof(BodyRecord) == 96, "SceneFile::BodyRecord must be packed");
+
+	// Loads from the cache when it is current, compiles and caches otherwise.
+	// Throws on unreadable or invalid scenes.
+	explicit SceneFile(const std::string& path);
+
+	// Public interface
+	size_t size() const { return header().bodyCount; }
+	const BodyRecord& body(size_t index) const { return records()[index]; }
+	const char* string(uint32_t offset) const { return strings() + offset; }
+	bool loadedFromCache() const { return mapping != nullptr; }
+
+private:
+	std::string path;
+
+	// One of these holds the compiled scene
+	std::unique_ptr<MappedFile> mapping;
+	std::vector<unsigned char> compiled;
+
+	const unsigned char* bytes() const { return mapping ? mapping->data() : compiled.data(); }
+	const Header& header() const { return *reinterpret_cast<const Header*>(bytes()); }
+	const BodyRecord* records() const { return reinterpret_cast<const BodyRecord*>(bytes() + sizeof(Header)); }
+	const char* strings() const { return reinterpret_cast<const char*>(records() + size()); }
+
+	static bool consistent(const Header& cached, const unsigned char* bytes);
+	void compile(const std::string& source, uint64_t hash);
+};
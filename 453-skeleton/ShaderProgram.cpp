@@ -4,6 +4,7 @@
 #include <stdexcept>
 #include <vector>
 
+#include "GLDebug.h"
 #include "Log.h"
 
 
@@ -20,6 +21,7 @@ ShaderProgram::ShaderProgram(const std::string& vertexPath, const std::string& f
 		glDeleteProgram(programID);
 		throw std::runtime_error("Shaders did not link.");
 	}
+	GLDebug::label(GL_PROGRAM, programID, vertexPath + " + " + fragmentPath);
 }
 
 bool ShaderProgram::recompile() {
@@ -0,0 +1,70 @@
+#include "Skybox.h"
+
+#include "GLState.h"
+#include "Projection.h"
+#include "RenderStats.h"
+
+
+namespace {
+
+	// 12 triangles, wound counter-clockwise when seen from inside the cube
+	const float cubeVerts[] = {
+		-1.0f,  1.0f, -1.0f,  -1.0f, -1.0f, -1.0f,   1.0f, -1.0f, -1.0f,
+		 1.0f, -1.0f, -1.0f,   1.0f,  1.0f, -1.0f,  -1.0f,  1.0f, -1.0f,
+
+		-1.0f, -1.0f,  1.0f,  -1.0f, -1.0f, -1.0f,  -1.0f,  1.0f, -1.0f,
+		-1.0f,  1.0f, -1.0f,  -1.0f,  1.0f,  1.0f,  -1.0f, -1.0f,  1.0f,
+
+		 1.0f, -1.0f, -1.0f,   1.0f, -1.0f,  1.0f,   1.0f,  1.0f,  1.0f,
+		 1.0f,  1.0f,  1.0f,   1.0f,  1.0f, -1.0f,   1.0f, -1.0f, -1.0f,
+
+		-1.0f, -1.0f,  1.0f,  -1.0f,  1.0f,  1.0f,   1.0f,  1.0f,  1.0f,
+		 1.0f,  1.0f,  1.0f,   1.0f, -1.0f,  1.0f,  -1.0f, -1.0f,  1.0f,
+
+		-1.0f,  1.0f, -1.0f,   1.0f,  1.0f, -1.0f,   1.0f,  1.0f,  1.0f,
+		 1.0f,  1.0f,  1.0f,  -1.0f,  1.0f,  1.0f,  -1.0f,  1.0f, -1.0f,
+
+		-1.0f, -1.0f, -1.0f,  -1.0f, -1.0f,  1.0f,   1.0f, -1.0f, -1.0f,
+		 1.0f, -1.0f, -1.0f,  -1.0f, -1.0f,  1.0f,   1.0f, -1.0f,  1.0f,
+	};
+}
+
+
+Skybox::Skybox(const std::string& panoramaPath, int faceSize)
+	: cubemap(panoramaPath, faceSize)
+	, shader("shaders/skybox.vert", "shaders/skybox.frag")
+	, vao()
+	, cubeBuffer()
+	, brightness(0.12f)
+{
+	vao.bind();
+	GLState::bufferData(cubeBuffer, sizeof(cubeVerts), cubeVerts, GL_STATIC_DRAW);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, cubeBuffer);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glEnableVertexAttribArray(0);
+}
+
+
+void Skybox::draw(const glm::mat4& V, const glm::mat4& P) {
+	// Only the camera's orientation matters for something infinitely far away
+	glm::mat4 rotationOnly = glm::mat4(glm::mat3(V));
+
+	shader.use();
+	glUniformMatrix4fv(glGetUniformLocation(shader, "V"), 1, GL_FALSE, &rotationOnly[0][0]);
+	glUniformMatrix4fv(glGetUniformLocation(shader, "P"), 1, GL_FALSE, &P[0][0]);
+	glUniform1f(glGetUniformLocation(shader, "farPlane"), Projection::farPlane());
+	glUniform1f(glGetUniformLocation(shader, "brightness"), brightness);
+
+	// The cube sits exactly on the far plane, so it has to pass the or-equal
+	// depth test and must not write depth for anything drawn after it
+	GLState::depthFunc(Projection::depthFuncOrEqual());
+	GLState::depthMask(GL_FALSE);
+
+	vao.bind();
+	cubemap.bind();
+	glDrawArrays(GL_TRIANGLES, 0, 36);
+	RenderStats::countDraw(36);
+
+	GLState::depthMask(GL_TRUE);
+	GLState::depthFunc(Projection::depthFunc());
+}
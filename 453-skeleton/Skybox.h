@@ -0,0 +1,44 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains the background renderer.
+//
+// A unit cube is drawn around the camera with the translation removed from the
+// view matrix and its depth forced to the far plane. It is drawn after all
+// opaque geometry, so only pixels nothing else covered get shaded.
+//------------------------------------------------------------------------------
+
+#include "Cubemap.h"
+#include "GLHandles.h"
+#include "ShaderProgram.h"
+#include "VertexArray.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+
+
+class Skybox {
+
+public:
+	Skybox(const std::string& panoramaPath, int faceSize = 1024);
+
+	// Public interface
+	void draw(const glm::mat4& V, const glm::mat4& P);
+
+	// The old background sphere was only ever lit by ambient light, so the
+	// panorama is dimmed by the same amount by default
+	void setBrightness(float b) { brightness = b; }
+
+private:
+	Cubemap cubemap;
+	ShaderProgram shader;
+
+	// note: due to how OpenGL works, vao needs to be
+	// defined and initialized before the vertex buffer
+	VertexArray vao;
+	VertexBufferHandle cubeBuffer;
+
+	float brightness;
+};
@@ -0,0 +1,494 @@
+#include "SpkEphemeris.h"
+
+#include "Frames.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <set>
+#include <stdexcept>
+
+
+namespace {
+
+	const size_t recordBytes = 1024;
+
+	// NAIF frame codes
+	const int j2000Frame = 1;
+	const int eclipticFrame = 17;
+
+	// Longest chain of centres followed, e.g. spacecraft -> moon -> planet
+	// barycentre -> solar system barycentre
+	const int maxChain = 16;
+
+	// Type 13 windows are at most this many states
+	const int maxWindow = 32;
+
+	// Timelines each thread remembers; a chain rarely has more bodies
+	const uint32_t rememberedCount = 8;
+
+	// Numbers the sets of timelines of every instance, so a thread can't
+	// mistake one for another
+	std::atomic<uint64_t> generations{ 0 };
+
+	template <typename T>
+	T read(const unsigned char* bytes, size_t offset) {
+		T value;
+		std::memcpy(&value, bytes + offset, sizeof(T));
+		return value;
+	}
+
+	// Value and slope of a Chebyshev series at x in [-1, 1]
+	void clenshaw(const double* c, size_t n, double x, double& value, double& slope) {
+		double b1 = 0.0, b2 = 0.0, d1 = 0.0, d2 = 0.0;
+		for (size_t k = n - 1; k >= 1; k--) {
+			double b = c[k] + 2.0 * x * b1 - b2;
+			double d = 2.0 * b1 + 2.0 * x * d1 - d2;
+			b2 = b1;
+			b1 = b;
+			d2 = d1;
+			d1 = d;
+		}
+		value = c[0] + x * b1 - b2;
+		slope = b1 + x * d1 - d2;
+	}
+
+	// Hermite interpolation through values and slopes at count nodes, by
+	// divided differences with every node repeated; evaluated at t = 0
+	void hermite(const double* t, const double* f, const double* df, int count, double& value, double& slope) {
+		const int m = 2 * count;
+		double z[2 * maxWindow];
+		double q[2 * maxWindow] = {};
+		for (int j = 0; j < count; j++) {
+			z[2 * j] = z[2 * j + 1] = t[j];
+			q[2 * j] = q[2 * j + 1] = f[j];
+		}
+		for (int i = m - 1; i >= 1; i--) {
+			q[i] = (i % 2 == 1) ? df[i / 2] : (q[i] - q[i - 1]) / (z[i] - z[i - 1]);
+		}
+		for (int level = 2; level < m; level++) {
+			for (int i = m - 1; i >= level; i--) {
+				q[i] = (q[i] - q[i - 1]) / (z[i] - z[i - level]);
+			}
+		}
+
+		// Newton form, with its derivative alongside
+		value = q[m - 1];
+		slope = 0.0;
+		for (int k = m - 2; k >= 0; k--) {
+			slope = slope * -z[k] + value;
+			value = value * -z[k] + q[k];
+		}
+	}
+}
+
+
+void SpkEphemeris::load(const std::string& path) {
+	auto file = std::make_unique<MappedFile>(path);
+	const unsigned char* bytes = file->data();
+	const size_t size = file->size();
+
+	auto fail = [&path](const char* reason) {
+		Log::error("SPK {} {}", path, reason);
+		throw std::runtime_error("Invalid SPK kernel.");
+	};
+
+	if (size < recordBytes || (std::memcmp(bytes, "DAF/SPK ", 8) != 0 && std::memcmp(bytes, "NAIF/DAF", 8) != 0)) {
+		fail("is not an SPK kernel");
+	}
+	// Pre-1995 files leave the format blank and are in the writer's order
+	if (std::memcmp(bytes + 88, "LTL-IEEE", 8) != 0 && std::memcmp(bytes + 88, "        ", 8) != 0) {
+		fail("is not little-endian IEEE; convert it with NAIF's toxfr/tobin");
+	}
+	int32_t nd = read<int32_t>(bytes, 8);
+	int32_t ni = read<int32_t>(bytes, 12);
+	if (nd != 2 || ni != 6) {
+		fail("has summaries of the wrong shape for an SPK kernel");
+	}
+	const size_t summaryDoubles = size_t(nd + (ni + 1) / 2);
+
+	// Summary records form a linked list; each holds next, previous and
+	// a count, then the summaries
+	std::vector<Segment> found;
+	size_t visited = 0;
+	for (int32_t record = read<int32_t>(bytes, 76); record > 0; ) {
+		size_t offset = size_t(record - 1) * recordBytes;
+		if (offset + recordBytes > size || ++visited > size / recordBytes) {
+			fail("has a broken summary list");
+		}
+		double next = read<double>(bytes, offset);
+		size_t count = size_t(read<double>(bytes, offset + 16));
+		if (3 + count * summaryDoubles > recordBytes / sizeof(double)) {
+			fail("has a broken summary record");
+		}
+
+		for (size_t s = 0; s < count; s++) {
+			size_t at = offset + (3 + s * summaryDoubles) * sizeof(double);
+			int32_t ic[6];
+			std::memcpy(ic, bytes + at + 2 * sizeof(double), sizeof(ic));
+
+			// Addresses count doubles from one
+			size_t begin = size_t(ic[4]);
+			size_t end = size_t(ic[5]);
+			if (begin < 1 || end < begin || end * sizeof(double) > size) {
+				fail("has a segment outside the file");
+			}
+
+			Segment segment{};
+			segment.data = reinterpret_cast<const double*>(bytes) + (begin - 1);
+			segment.length = end - begin + 1;
+			segment.start = read<double>(bytes, at);
+			segment.end = read<double>(bytes, at + sizeof(double));
+			segment.target = ic[0];
+			segment.center = ic[1];
+			segment.frame = ic[2];
+			segment.type = ic[3];
+			found.push_back(segment);
+		}
+		record = int32_t(next);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	segments.insert(segments.end(), found.begin(), found.end());
+	files.push_back(std::move(file));
+	timelines.clear();
+	generation = ++generations;
+	Log::info("SPK {} segments from {}", found.size(), path);
+}
+
+
+bool SpkEphemeris::prepare(Segment& segment) const {
+	const double* d = segment.data;
+	const size_t n = segment.length;
+	if (segment.frame != j2000Frame && segment.frame != eclipticFrame) {
+		return false;
+	}
+
+	if (segment.type == 2 || segment.type == 3) {
+		// Trailer: start of the first record, record length in seconds,
+		// doubles per record, record count
+		if (n < 4) {
+			return false;
+		}
+		segment.init = d[n - 4];
+		segment.intervalLength = d[n - 3];
+		segment.recordSize = size_t(d[n - 2]);
+		segment.recordCount = size_t(d[n - 1]);
+		size_t components = segment.type == 2 ? 3 : 6;
+		return segment.intervalLength > 0.0 && segment.recordCount > 0 && segment.init <= segment.start
+			&& segment.recordSize > 2 + components && (segment.recordSize - 2) % components == 0
+			&& segment.recordSize * segment.recordCount + 4 == n;
+	}
+
+	if (segment.type == 13) {
+		// States, epochs, a directory of every 100th epoch, then the
+		// window size less one and the state count
+		if (n < 2) {
+			return false;
+		}
+		segment.window = int(d[n - 2]) + 1;
+		segment.recordCount = size_t(d[n - 1]);
+		size_t directory = segment.recordCount > 0 ? (segment.recordCount - 1) / 100 : 0;
+		return segment.window >= 2 && segment.window <= maxWindow && size_t(segment.window) <= segment.recordCount
+			&& 7 * segment.recordCount + directory + 2 == n;
+	}
+	return false;
+}
+
+
+const SpkEphemeris::Timeline& SpkEphemeris::timeline(int target) const {
+	// Each thread remembers the timelines it used last, so threads querying
+	// together don't queue on the mutex. Loading a kernel starts a new
+	// generation, which forgets them.
+	struct Remembered {
+		uint64_t generation;
+		int target;
+		const Timeline* timeline;
+	};
+	thread_local Remembered remembered[rememberedCount] = {};
+	Remembered& slot = remembered[uint32_t(target) % rememberedCount];
+	if (slot.generation == generation && slot.target == target && generation != 0) {
+		return *slot.timeline;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = timelines.find(target);
+	if (it != timelines.end()) {
+		slot = { generation, target, it->second.get() };
+		return *it->second;
+	}
+
+	// Segments in priority order, later ones winning
+	std::vector<uint32_t> candidates;
+	for (uint32_t i = 0; i < segments.size(); i++) {
+		Segment& segment = segments[i];
+		if (segment.target != target || !(segment.end > segment.start)) {
+			continue;
+		}
+		if (prepare(segment)) {
+			candidates.push_back(i);
+		}
+		else {
+			Log::warn("SPK skipping a segment for body {} (type {}, frame {}) that can't be read", target, segment.type, segment.frame);
+		}
+	}
+
+	// Cut at every boundary; each piece belongs to the highest priority
+	// segment active over it, and neighbouring pieces of one segment merge
+	struct Event {
+		double time;
+		bool starts;
+		uint32_t segment;
+	};
+	std::vector<Event> events;
+	for (uint32_t i : candidates) {
+		events.push_back({ segments[i].start, true, i });
+		events.push_back({ segments[i].end, false, i });
+	}
+	std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.time < b.time; });
+
+	auto built = std::make_unique<Timeline>();
+	std::set<uint32_t> active;
+	for (size_t e = 0; e < events.size(); ) {
+		double time = events[e].time;
+		for (; e < events.size() && events[e].time == time; e++) {
+			if (events[e].starts) {
+				active.insert(events[e].segment);
+			}
+			else {
+				active.erase(events[e].segment);
+			}
+		}
+		if (active.empty() || e == events.size()) {
+			continue;
+		}
+		uint32_t owner = *active.rbegin();
+		double until = events[e].time;
+		if (!built->segments.empty() && built->segments.back() == owner && built->ends.back() == time) {
+			built->ends.back() = until;
+		}
+		else {
+			built->starts.push_back(time);
+			built->ends.push_back(until);
+			built->segments.push_back(owner);
+		}
+	}
+
+	const Timeline& result = *built;
+	timelines.emplace(target, std::move(built));
+	slot = { generation, target, &result };
+	return result;
+}
+
+
+const SpkEphemeris::Segment* SpkEphemeris::find(const Timeline& timeline, double et) const {
+	if (timeline.starts.empty()) {
+		return nullptr;
+	}
+
+	// Frames ask for nearly the same time over and over
+	size_t i = timeline.last.load(std::memory_order_relaxed);
+	if (i >= timeline.starts.size() || et < timeline.starts[i] || et > timeline.ends[i]) {
+		auto after = std::upper_bound(timeline.starts.begin(), timeline.starts.end(), et);
+		if (after == timeline.starts.begin()) {
+			return nullptr;
+		}
+		i = size_t(after - timeline.starts.begin()) - 1;
+		if (et > timeline.ends[i]) {
+			return nullptr;
+		}
+		timeline.last.store(i, std::memory_order_relaxed);
+	}
+	return &segments[timeline.segments[i]];
+}
+
+
+SpkEphemeris::State SpkEphemeris::evaluate(const Segment& segment, double et, size_t* cursor) const {
+	State state;
+
+	if (segment.type == 2 || segment.type == 3) {
+		double index = std::floor((et - segment.init) / segment.intervalLength);
+		size_t r = size_t(std::clamp(index, 0.0, double(segment.recordCount - 1)));
+		const double* record = segment.data + r * segment.recordSize;
+		const double middle = record[0];
+		const double radius = record[1];
+		const double x = (et - middle) / radius;
+
+		size_t n = (segment.recordSize - 2) / (segment.type == 2 ? 3 : 6);
+		for (int i = 0; i < 3; i++) {
+			double value, slope;
+			clenshaw(record + 2 + i * n, n, x, value, slope);
+			state.position[i] = value;
+			state.velocity[i] = slope / radius;
+			if (segment.type == 3) {
+				clenshaw(record + 2 + (3 + i) * n, n, x, value, slope);
+				state.velocity[i] = value;
+			}
+		}
+	}
+	else {
+		// The window of states around et, as even on both sides as the
+		// ends of the segment allow
+		const size_t count = segment.recordCount;
+		const int window = segment.window;
+		const double* states = segment.data;
+		const double* epochs = segment.data + 6 * count;
+		size_t from = cursor && *cursor > 0 && *cursor <= count && epochs[*cursor - 1] <= et ? *cursor : 0;
+		size_t after = size_t(std::upper_bound(epochs + from, epochs + count, et) - epochs);
+		if (cursor) {
+			*cursor = after;
+		}
+		size_t first = after > size_t(window / 2) ? after - size_t(window / 2) : 0;
+		first = std::min(first, count - size_t(window));
+
+		double t[maxWindow], f[maxWindow], df[maxWindow];
+		for (int j = 0; j < window; j++) {
+			t[j] = epochs[first + j] - et;
+		}
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < window; j++) {
+				f[j] = states[6 * (first + j) + i];
+				df[j] = states[6 * (first + j) + 3 + i];
+			}
+			hermite(t, f, df, window, state.position[i], state.velocity[i]);
+		}
+	}
+
+	if (segment.frame == eclipticFrame) {
+		state.position = Frames::eclipticToEquatorial(state.position);
+		state.velocity = Frames::eclipticToEquatorial(state.velocity);
+	}
+	return state;
+}
+
+
+int SpkEphemeris::chain(int body, double et, int nodes[], State offsets[], int capacity) const {
+	nodes[0] = body;
+	offsets[0] = State{ glm::dvec3(0.0), glm::dvec3(0.0) };
+	int count = 1;
+	while (nodes[count - 1] != 0 && count < capacity) {
+		const Segment* segment = find(timeline(nodes[count - 1]), et);
+		if (segment == nullptr) {
+			break;
+		}
+		State step = evaluate(*segment, et);
+		nodes[count] = segment->center;
+		offsets[count].position = offsets[count - 1].position + step.position;
+		offsets[count].velocity = offsets[count - 1].velocity + step.velocity;
+		count++;
+	}
+	return count;
+}
+
+
+bool SpkEphemeris::tryState(int target, int center, double et, State& state) const {
+	int targetNodes[maxChain], centerNodes[maxChain];
+	State targetOffsets[maxChain], centerOffsets[maxChain];
+	int targetCount = chain(target, et, targetNodes, targetOffsets, maxChain);
+	int centerCount = chain(center, et, centerNodes, centerOffsets, maxChain);
+
+	// The first body both chains pass through
+	for (int i = 0; i < targetCount; i++) {
+		for (int j = 0; j < centerCount; j++) {
+			if (targetNodes[i] == centerNodes[j]) {
+				state.position = targetOffsets[i].position - centerOffsets[j].position;
+				state.velocity = targetOffsets[i].velocity - centerOffsets[j].velocity;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+
+SpkEphemeris::State SpkEphemeris::state(int target, int center, double et) const {
+	State result;
+	if (!tryState(target, center, et, result)) {
+		Log::error("SPK no loaded kernel connects body {} to {} at {} s past J2000", target, center, et);
+		throw std::runtime_error("Body not covered by the SPK kernels.");
+	}
+	return result;
+}
+
+
+int SpkEphemeris::links(int body, double et, int nodes[], const Segment* steps[], int capacity, double& from, double& to) const {
+	nodes[0] = body;
+	from = -std::numeric_limits<double>::infinity();
+	to = std::numeric_limits<double>::infinity();
+	int count = 1;
+	while (nodes[count - 1] != 0 && count < capacity) {
+		// The interval et falls in, or the gap between two, bounds the span
+		const Timeline& line = timeline(nodes[count - 1]);
+		size_t after = size_t(std::upper_bound(line.starts.begin(), line.starts.end(), et) - line.starts.begin());
+		if (after == 0 || et > line.ends[after - 1]) {
+			from = std::max(from, after > 0 ? line.ends[after - 1] : from);
+			to = std::min(to, after < line.starts.size() ? line.starts[after] : to);
+			break;
+		}
+		from = std::max(from, line.starts[after - 1]);
+		to = std::min(to, line.ends[after - 1]);
+
+		const Segment* segment = &segments[line.segments[after - 1]];
+		steps[count - 1] = segment;
+		nodes[count] = segment->center;
+		count++;
+	}
+	return count;
+}
+
+
+void SpkEphemeris::states(int target, int center, const double* ets, size_t count, State* out) const {
+	int targetNodes[maxChain], centerNodes[maxChain];
+	const Segment* targetSteps[maxChain];
+	const Segment* centerSteps[maxChain];
+	size_t targetCursors[maxChain], centerCursors[maxChain];
+	int targetLength = 0, centerLength = 0;
+
+	// Span over which the resolved chains hold; boundaries are resolved
+	// again, as each belongs to one side only
+	double from = 0.0, to = 0.0;
+
+	for (size_t k = 0; k < count; k++) {
+		double et = ets[k];
+		if (!(et > from && et < to)) {
+			double targetFrom, targetTo, centerFrom, centerTo;
+			int targetCount = links(target, et, targetNodes, targetSteps, maxChain, targetFrom, targetTo);
+			int centerCount = links(center, et, centerNodes, centerSteps, maxChain, centerFrom, centerTo);
+			from = std::max(targetFrom, centerFrom);
+			to = std::min(targetTo, centerTo);
+
+			// Only the steps up to the first body both chains pass through
+			targetLength = -1;
+			for (int i = 0; i < targetCount && targetLength < 0; i++) {
+				for (int j = 0; j < centerCount; j++) {
+					if (targetNodes[i] == centerNodes[j]) {
+						targetLength = i;
+						centerLength = j;
+						break;
+					}
+				}
+			}
+			if (targetLength < 0) {
+				Log::error("SPK no loaded kernel connects body {} to {} at {} s past J2000", target, center, et);
+				throw std::runtime_error("Body not covered by the SPK kernels.");
+			}
+			std::fill(targetCursors, targetCursors + maxChain, 0);
+			std::fill(centerCursors, centerCursors + maxChain, 0);
+		}
+
+		State result{ glm::dvec3(0.0), glm::dvec3(0.0) };
+		for (int i = 0; i < targetLength; i++) {
+			State step = evaluate(*targetSteps[i], et, &targetCursors[i]);
+			result.position += step.position;
+			result.velocity += step.velocity;
+		}
+		for (int j = 0; j < centerLength; j++) {
+			State step = evaluate(*centerSteps[j], et, &centerCursors[j]);
+			result.position -= step.position;
+			result.velocity -= step.velocity;
+		}
+		out[k] = result;
+	}
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a reader for NAIF SPICE SPK kernels (.bsp).
+//
+// Kernels are DAF files: a file record, a linked list of summary records
+// describing each segment, and the segments' doubles. Loading maps the file
+// and reads only the summaries, so loading dozens of large kernels costs a
+// few pages each. Segments of type 2 and 3 (Chebyshev, equal intervals) and
+// 13 (Hermite, unequal steps) are supported; anything else is skipped.
+//
+// The first query for a target builds its timeline: the segments covering
+// it, cut into disjoint intervals so each instant belongs to the segment
+// SPICE would pick (the last loaded, and the later in a file). Lookups are a
+// binary search, started from the interval the previous query used, and
+// threads remember the timelines they used so they rarely take a lock.
+// Segments' own parameters are read the first time they are needed.
+//
+// Bodies use NAIF ids: 0 the solar system barycentre, 10 the Sun, 1-9 the
+// planetary barycentres, 399 the Earth, 301 the Moon, negative ids for
+// spacecraft. A query walks each body's chain of centres until the two
+// chains meet. Results are kilometres and kilometres per second on J2000
+// axes; ecliptic segments are rotated on the way out. Queries may come from
+// any thread. Only little-endian kernels are read.
+//------------------------------------------------------------------------------
+
+#include "MappedFile.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+class SpkEphemeris {
+
+public:
+	struct State {
+		glm::dvec3 position;
+		glm::dvec3 velocity;
+	};
+
+	SpkEphemeris() = default;
+
+	// Maps a kernel and reads its summaries. Throws if it isn't a readable
+	// SPK file. Later kernels take precedence over earlier ones.
+	void load(const std::string& path);
+
+	// Public interface
+	// et is TDB seconds past J2000 (see Frames::secondsPastJ2000)
+	bool tryState(int target, int center, double et, State& state) const;
+
+	// Throws where the kernels can't connect the two bodies at et
+	State state(int target, int center, double et) const;
+
+	// The same for many epochs. The chains are resolved again only when an
+	// epoch leaves the span of the segments last used, so epochs in order
+	// cost little more than evaluating the segments.
+	void states(int target, int center, const double* ets, size_t count, State* out) const;
+
+	size_t kernelCount() const { return files.size(); }
+	size_t segmentCount() const { return segments.size(); }
+
+private:
+	struct Segment {
+		const double* data;		// first double of the segment
+		size_t length;
+		int target;
+		int center;
+		int frame;
+		int type;
+		double start;
+		double end;
+
+		// Read from the segment itself when its target's timeline is built
+		double init;
+		double intervalLength;
+		size_t recordSize;
+		size_t recordCount;
+		int window;
+	};
+
+	// Disjoint intervals, sorted; segments[i] covers [starts[i], ends[i]]
+	struct Timeline {
+		std::vector<double> starts;
+		std::vector<double> ends;
+		std::vector<uint32_t> segments;
+		mutable std::atomic<size_t> last{ 0 };
+	};
+
+	std::vector<std::unique_ptr<MappedFile>> files;
+
+	// The mutex guards the timelines and the parameters segments get when
+	// their target's timeline is built
+	mutable std::mutex mutex;
+	mutable std::vector<Segment> segments;
+	mutable std::map<int, std::unique_ptr<Timeline>> timelines;
+	uint64_t generation = 0;		// changes whenever timelines are dropped
+
+	const Timeline& timeline(int target) const;
+	const Segment* find(const Timeline& timeline, double et) const;
+	bool prepare(Segment& segment) const;
+
+	// cursor, when given, is where the last type 13 search ended, so epochs
+	// in increasing order don't search the whole segment again
+	State evaluate(const Segment& segment, double et, size_t* cursor = nullptr) const;
+
+	// Offsets of the body from each centre along its chain
+	int chain(int body, double et, int nodes[], State offsets[], int capacity) const;
+
+	// The segments of that chain, and the span (from, to) around et over
+	// which every one of them stays the same
+	int links(int body, double et, int nodes[], const Segment* steps[], int capacity, double& from, double& to) const;
+};
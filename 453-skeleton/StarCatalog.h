@@ -0,0 +1,41 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file describes the binary star catalog format.
+//
+// The file is a header followed by a tightly packed array of StarRecords, so
+// it can be memory mapped and handed to OpenGL without any parsing. It is
+// written by tools/starconv from a text catalog and read by StarField.
+//
+// Positions are unit directions in the ecliptic frame (z towards the north
+// ecliptic pole), matching the reference plane the orbits are drawn in.
+//------------------------------------------------------------------------------
+
+#include <cstdint>
+
+
+namespace StarCatalog {
+
+	const char magic[4] = { 'O', 'S', 'T', 'R' };
+	const uint32_t version = 1;
+
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint32_t count;
+		uint32_t recordSize;
+	};
+
+	struct StarRecord {
+		float direction[3];
+		float magnitude;
+
+		// Colour baked from the B-V index at conversion time. Linear RGB,
+		// since the framebuffer applies the sRGB encoding
+		uint8_t color[3];
+		uint8_t padding;
+	};
+
+	static_assert(sizeof(Header) == 16, "StarCatalog::Header must be packed");
+	static_assert(sizeof(StarRecord) == 20, "StarCatalog::StarRecord must be packed");
+}
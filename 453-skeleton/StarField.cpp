@@ -0,0 +1,85 @@
+#include "StarField.h"
+
+#include "GLState.h"
+#include "Log.h"
+#include "MappedFile.h"
+#include "Projection.h"
+#include "RenderStats.h"
+#include "StarCatalog.h"
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+
+StarField::StarField(const std::string& catalogPath)
+	: shader("shaders/starfield.vert", "shaders/starfield.frag")
+	, vao()
+	, starBuffer()
+	, count(0)
+	, magnitudeLimit(6.5f)
+	, pointScale(1.0f)
+{
+	using StarCatalog::Header;
+	using StarCatalog::StarRecord;
+
+	// The mapping only has to live until the upload below
+	MappedFile file(catalogPath);
+
+	if (file.size() < sizeof(Header)) {
+		throw std::runtime_error("Star catalog is too small.");
+	}
+	Header header;
+	std::memcpy(&header, file.data(), sizeof(Header));
+
+	if (std::memcmp(header.magic, StarCatalog::magic, sizeof(header.magic)) != 0
+		|| header.version != StarCatalog::version
+		|| header.recordSize != sizeof(StarRecord)
+		|| file.size() < sizeof(Header) + size_t(header.count) * sizeof(StarRecord)) {
+		Log::error("STAR_FIELD {} is not a version {} star catalog", catalogPath, StarCatalog::version);
+		throw std::runtime_error("Invalid star catalog.");
+	}
+	count = GLsizei(header.count);
+
+	vao.bind();
+	GLState::bufferData(starBuffer, sizeof(StarRecord) * count, file.data() + sizeof(Header), GL_STATIC_DRAW);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, starBuffer);
+
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(StarRecord), (void*)offsetof(StarRecord, direction));
+	glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(StarRecord), (void*)offsetof(StarRecord, magnitude));
+	glVertexAttribPointer(2, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(StarRecord), (void*)offsetof(StarRecord, color));
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+
+	Log::info("STAR_FIELD loaded {} stars from {}", count, catalogPath);
+}
+
+
+void StarField::draw(const glm::mat4& V, const glm::mat4& P) {
+	// Stars are at infinity, so like the skybox only rotation matters
+	glm::mat4 rotationOnly = glm::mat4(glm::mat3(V));
+
+	shader.use();
+	glUniformMatrix4fv(glGetUniformLocation(shader, "V"), 1, GL_FALSE, &rotationOnly[0][0]);
+	glUniformMatrix4fv(glGetUniformLocation(shader, "P"), 1, GL_FALSE, &P[0][0]);
+	glUniform1f(glGetUniformLocation(shader, "farPlane"), Projection::farPlane());
+	glUniform1f(glGetUniformLocation(shader, "magnitudeLimit"), magnitudeLimit);
+	glUniform1f(glGetUniformLocation(shader, "pointScale"), pointScale);
+
+	// Drawn over the skybox at the far plane; stars add light to it
+	GLState::enable(GL_PROGRAM_POINT_SIZE);
+	GLState::enable(GL_BLEND);
+	GLState::blendFunc(GL_ONE, GL_ONE);
+	GLState::depthFunc(Projection::depthFuncOrEqual());
+	GLState::depthMask(GL_FALSE);
+
+	vao.bind();
+	glDrawArrays(GL_POINTS, 0, count);
+	RenderStats::countDraw(count);
+
+	GLState::depthMask(GL_TRUE);
+	GLState::depthFunc(Projection::depthFunc());
+	GLState::disable(GL_BLEND);
+	GLState::disable(GL_PROGRAM_POINT_SIZE);
+}
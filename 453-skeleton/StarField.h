@@ -0,0 +1,46 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains the renderer for a real star field.
+//
+// The binary catalog (see StarCatalog.h) is memory mapped and uploaded to the
+// GPU once, straight from the mapping. Every star is then a point sprite at
+// infinity, sized by its magnitude and drawn in a single call.
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+#include "ShaderProgram.h"
+#include "VertexArray.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+
+
+class StarField {
+
+public:
+	explicit StarField(const std::string& catalogPath);
+
+	// Public interface
+	void draw(const glm::mat4& V, const glm::mat4& P);
+
+	GLsizei getCount() const { return count; }
+
+	// Stars fainter than this are not drawn
+	void setMagnitudeLimit(float limit) { magnitudeLimit = limit; }
+	void setPointScale(float scale) { pointScale = scale; }
+
+private:
+	ShaderProgram shader;
+
+	// note: due to how OpenGL works, vao needs to be
+	// defined and initialized before the vertex buffer
+	VertexArray vao;
+	VertexBufferHandle starBuffer;
+
+	GLsizei count;
+	float magnitudeLimit;
+	float pointScale;
+};
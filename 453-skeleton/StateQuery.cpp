@@ -0,0 +1,110 @@
+#include "StateQuery.h"
+
+#include "Frames.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <limits>
+#include <thread>
+
+
+namespace {
+
+	// Epochs per run: enough to amortise taking one, few enough that the
+	// last runs don't leave cores idle
+	const size_t runEpochs = 2048;
+}
+
+
+StateQuery::StateQuery(const Ephemeris* ephemeris, const SpkEphemeris* spk)
+	: ephemeris(ephemeris)
+	, spk(spk)
+{}
+
+
+// Barycentric, the ephemeris' own origin; velocities per second, as SPK
+bool StateQuery::ephemerisState(int body, double julianDate, State& state) const {
+	if (body == 0) {
+		state = State{ glm::dvec3(0.0), glm::dvec3(0.0) };
+		return true;
+	}
+	Ephemeris::Body series;
+	if (!ephemeris || !Ephemeris::bodyFromNaifId(body, series) || !ephemeris->covers(julianDate)) {
+		return false;
+	}
+	Ephemeris::State barycentric = ephemeris->state(series, julianDate);
+	state.position = barycentric.position;
+	state.velocity = barycentric.velocity / Frames::secondsPerDay;
+	return true;
+}
+
+
+bool StateQuery::state(int body, int center, double julianDate, State& state) const {
+	if (spk && spk->tryState(body, center, Frames::secondsPastJ2000(julianDate), state)) {
+		return true;
+	}
+	State target, origin;
+	if (!ephemeris || !ephemerisState(body, julianDate, target) || !ephemerisState(center, julianDate, origin)) {
+		return false;
+	}
+	state.position = target.position - origin.position;
+	state.velocity = target.velocity - origin.velocity;
+	return true;
+}
+
+
+size_t StateQuery::run(const std::vector<int>& bodies, int center, const std::vector<double>& epochs, State* states, unsigned threadCount) const {
+	const size_t runsPerBody = (epochs.size() + runEpochs - 1) / runEpochs;
+	const size_t runCount = bodies.size() * runsPerBody;
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threadCount = unsigned(std::clamp<size_t>(runCount, 1, threadCount));
+
+	std::atomic<size_t> next{ 0 };
+	std::atomic<size_t> missing{ 0 };
+	auto work = [&]() {
+		const double nan = std::numeric_limits<double>::quiet_NaN();
+		size_t missed = 0;
+		for (size_t run = next++; run < runCount; run = next++) {
+			size_t b = run / runsPerBody;
+			size_t first = (run % runsPerBody) * runEpochs;
+			size_t last = std::min(first + runEpochs, epochs.size());
+			State* out = states + b * epochs.size();
+			for (size_t e = first; e < last; e++) {
+				if (!state(bodies[b], center, epochs[e], out[e])) {
+					out[e] = State{ glm::dvec3(nan), glm::dvec3(nan) };
+					missed++;
+				}
+			}
+		}
+		missing += missed;
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned i = 1; i < threadCount; i++) {
+		threads.emplace_back(work);
+	}
+	work();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	return missing;
+}
+
+
+bool StateQuery::bodyFromName(const std::string& name, int& id) {
+	char* end = nullptr;
+	long value = std::strtol(name.c_str(), &end, 10);
+	if (!name.empty() && *end == '\0') {
+		id = int(value);
+		return true;
+	}
+	Ephemeris::Body body;
+	if (Ephemeris::bodyFromName(name, body)) {
+		id = Ephemeris::naifId(body);
+		return true;
+	}
+	return false;
+}
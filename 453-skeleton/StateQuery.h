@@ -0,0 +1,48 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains batch state queries for many bodies at many epochs.
+//
+// Bodies are NAIF ids. Each is looked up in the SPK kernels first, then in the
+// DE ephemeris, so a scene's sources can answer offline questions without
+// drawing anything. The bodies x epochs grid is cut into runs of consecutive
+// epochs of one body; worker threads take runs from a shared counter until
+// none are left, so uneven sources still keep every core busy, and each run
+// walks its source's records in order. Workers only write their own runs of
+// the output, so the work scales with cores.
+//------------------------------------------------------------------------------
+
+#include "Ephemeris.h"
+#include "SpkEphemeris.h"
+
+#include <string>
+#include <vector>
+
+
+class StateQuery {
+
+public:
+	// Kilometres and kilometres per second on ICRF axes, as in SPK kernels
+	using State = SpkEphemeris::State;
+
+	// Either source may be null
+	StateQuery(const Ephemeris* ephemeris, const SpkEphemeris* spk);
+
+	// Public interface
+	// One state at a TDB Julian date; false where neither source has it
+	bool state(int body, int center, double julianDate, State& state) const;
+
+	// Fills states[b * epochs.size() + e] with bodies[b] relative to center at
+	// epochs[e], on threadCount threads (0 for one per core). States no
+	// source covers are NaN; returns how many there were.
+	size_t run(const std::vector<int>& bodies, int center, const std::vector<double>& epochs, State* states, unsigned threadCount = 0) const;
+
+	// A NAIF id, or the name of a body of the DE ephemeris ("earth")
+	static bool bodyFromName(const std::string& name, int& id);
+
+private:
+	const Ephemeris* ephemeris;
+	const SpkEphemeris* spk;
+
+	bool ephemerisState(int body, double julianDate, State& state) const;
+};
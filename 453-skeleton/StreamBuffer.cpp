@@ -0,0 +1,104 @@
+#include "StreamBuffer.h"
+
+#include "GLDebug.h"
+#include "GLState.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+
+#include <cstring>
+#include <stdexcept>
+
+
+StreamBuffer::StreamBuffer(GLsizeiptr regionSize, int regionCount)
+	: bufferID()
+	, regionSize(regionSize)
+	, regionCount(regionCount)
+	, region(regionCount - 1)
+	, head(0)
+	, mapped(nullptr)
+	, fences(regionCount, nullptr)
+{
+	GLsizeiptr totalSize = regionSize * regionCount;
+	GLState::bindBuffer(GL_ARRAY_BUFFER, bufferID);
+
+	if (GLEW_ARB_buffer_storage) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, totalSize, nullptr, flags);
+		mapped = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSize, flags));
+	}
+
+	if (mapped == nullptr) {
+		Log::warn("STREAM_BUFFER persistent mapping unavailable, falling back to glBufferSubData");
+		glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+		shadow.resize(regionSize);
+	}
+	GLDebug::label(GL_BUFFER, bufferID, "stream ring");
+}
+
+
+StreamBuffer::~StreamBuffer() {
+	for (GLsync fence : fences) {
+		glDeleteSync(fence);
+	}
+
+	if (mapped != nullptr) {
+		GLState::bindBuffer(GL_ARRAY_BUFFER, bufferID);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+}
+
+
+void StreamBuffer::beginFrame() {
+	region = (region + 1) % regionCount;
+	head = 0;
+
+	// Wait until the GPU is done with the last frame that used this region.
+	// With a few regions in flight this almost never actually blocks.
+	GLsync& fence = fences[region];
+	if (fence != nullptr) {
+		PROFILE_ZONE("stream wait");
+		GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (status == GL_TIMEOUT_EXPIRED) {
+			status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+}
+
+
+void StreamBuffer::endFrame() {
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+
+StreamBuffer::Allocation StreamBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment) {
+	GLsizeiptr start = (head + alignment - 1) / alignment * alignment;
+	if (start + size > regionSize) {
+		Log::error("STREAM_BUFFER out of space: {} bytes requested, {} of {} used", size, head, regionSize);
+		throw std::runtime_error("StreamBuffer region overflow.");
+	}
+	head = start + size;
+
+	unsigned char* base = mapped != nullptr ? mapped + region * regionSize : shadow.data();
+	return { base + start, region * regionSize + start, size };
+}
+
+
+StreamBuffer::Allocation StreamBuffer::write(const void* data, GLsizeiptr size, GLsizeiptr alignment) {
+	Allocation allocation = allocate(size, alignment);
+	std::memcpy(allocation.data, data, size);
+	flush(allocation);
+	return allocation;
+}
+
+
+void StreamBuffer::flush(const Allocation& allocation) {
+	// Counted either way: coherent writes cross the bus just the same
+	RenderStats::countUpload(allocation.size);
+
+	if (mapped == nullptr) {
+		GLState::bufferSubData(bufferID, allocation.offset, allocation.size, allocation.data);
+	}
+}
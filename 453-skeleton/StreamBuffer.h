@@ -0,0 +1,67 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a ring buffer for streaming per-frame data to the GPU.
+//
+// The buffer is allocated once with immutable storage and stays mapped for its
+// whole lifetime. It is split into one region per frame in flight; every frame
+// writes into the next region, and a fence placed at the end of the frame
+// guards the region against being overwritten while the GPU still reads it.
+//
+// When ARB_buffer_storage is unavailable the same interface falls back to a
+// CPU copy of the region which is uploaded with glBufferSubData.
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+
+class StreamBuffer {
+
+public:
+	// A chunk of the current frame's region. data points at mapped (or
+	// shadow) memory, offset is where the same bytes live in the buffer.
+	struct Allocation {
+		void* data;
+		GLintptr offset;
+		GLsizeiptr size;
+	};
+
+	StreamBuffer(GLsizeiptr regionSize, int regionCount = 3);
+
+	// The buffer stays mapped and owns fence objects, so it can't be copied
+	// or moved without extra bookkeeping. Nothing needs that yet.
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer operator=(const StreamBuffer&) = delete;
+
+	~StreamBuffer();
+
+	// Public interface
+	void beginFrame();
+	void endFrame();
+
+	Allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 16);
+	Allocation write(const void* data, GLsizeiptr size, GLsizeiptr alignment = 16);
+
+	// Makes the bytes of an allocation visible to the GPU. This is free for a
+	// persistently mapped buffer and an upload for the fallback path.
+	void flush(const Allocation& allocation);
+
+	GLuint id() const { return bufferID; }
+	bool isPersistent() const { return mapped != nullptr; }
+
+private:
+	VertexBufferHandle bufferID;
+
+	GLsizeiptr regionSize;
+	int regionCount;
+	int region;
+	GLsizeiptr head;
+
+	unsigned char* mapped;
+	std::vector<unsigned char> shadow;
+	std::vector<GLsync> fences;
+};
@@ -1,4 +1,8 @@
 #include "Texture.h"
+
+#include "GLDebug.h"
+#include "Profiler.h"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
@@ -7,6 +11,8 @@
 Texture::Texture(std::string path, GLint interpolation)
 	: textureID(), path(path), interpolation(interpolation)
 {
+	PROFILE_ZONE("texture load");
+
 	int numComponents;
 	stbi_set_flip_vertically_on_load(true);
 	const char* pathData = path.c_str();
@@ -39,6 +45,7 @@ Texture::Texture(std::string path, GLint interpolation)
 		};
 		//Loads texture data into bound texture
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+		GLDebug::label(GL_TEXTURE, textureID, path);
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -0,0 +1,281 @@
+#include "TrajectoryCache.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+
+namespace {
+
+	const size_t chunkSamples = 64;
+
+	// Cubic Hermite between two samples h days apart, at s in [0, 1]
+	TrajectoryCache::State hermite(const TrajectoryCache::State& a, const TrajectoryCache::State& b, double h, double s) {
+		double s2 = s * s;
+		double s3 = s2 * s;
+		TrajectoryCache::State state;
+		state.position = (2.0 * s3 - 3.0 * s2 + 1.0) * a.position + (s3 - 2.0 * s2 + s) * h * a.velocity
+			+ (3.0 * s2 - 2.0 * s3) * b.position + (s3 - s2) * h * b.velocity;
+		state.velocity = (6.0 * s2 - 6.0 * s) / h * (a.position - b.position) + (3.0 * s2 - 4.0 * s + 1.0) * a.velocity
+			+ (3.0 * s2 - 2.0 * s) * b.velocity;
+		return state;
+	}
+}
+
+
+TrajectoryCache::TrajectoryCache(size_t memoryBudget)
+	: memoryBudget(memoryBudget)
+	, playhead(0.0)
+	, ahead(0.0)
+	, behind(0.0)
+	, playheadMoved(false)
+	, stopping(false)
+	, tick(0)
+	, worker(&TrajectoryCache::run, this)
+{}
+
+
+TrajectoryCache::~TrajectoryCache() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	worker.join();
+}
+
+
+int TrajectoryCache::addTrack(Source source, double tolerance, double initialStep, double minStep, double maxStep) {
+	auto track = std::make_unique<Track>();
+	track->source = std::move(source);
+	track->tolerance = tolerance;
+	track->minStep = minStep;
+	track->maxStep = maxStep;
+	track->step = std::clamp(initialStep, minStep, maxStep);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	tracks.push_back(std::move(track));
+	return int(tracks.size()) - 1;
+}
+
+
+bool TrajectoryCache::state(int index, double julianDate, State& state) {
+	std::unique_lock<std::mutex> lock(mutex);
+	Track& track = *tracks[size_t(index)];
+	if (interpolate(track, julianDate, state)) {
+		counters.hits++;
+		return true;
+	}
+	counters.misses++;
+
+	// Somewhere the playhead isn't: start filling around it instead
+	if (julianDate < playhead - behind || julianDate > playhead + ahead) {
+		playhead = julianDate;
+	}
+	playheadMoved = true;
+	lock.unlock();
+	wake.notify_one();
+
+	// Tracks are never removed and their sources never change
+	return track.source(julianDate, state);
+}
+
+
+void TrajectoryCache::setPlayhead(double julianDate, double ahead, double behind) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		playhead = julianDate;
+		this->ahead = ahead;
+		this->behind = behind;
+		playheadMoved = true;
+	}
+	wake.notify_one();
+}
+
+
+TrajectoryCache::Stats TrajectoryCache::stats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return counters;
+}
+
+
+void TrajectoryCache::logSummary() const {
+	Stats s;
+	size_t trackCount;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		s = counters;
+		trackCount = tracks.size();
+	}
+	uint64_t queries = s.hits + s.misses;
+	Log::info("TRAJECTORY {} tracks, {} queries ({:.1f}% cached), {} source samples, {} evictions, {:.1f} MB",
+		trackCount, queries, queries > 0 ? 100.0 * double(s.hits) / double(queries) : 0.0,
+		s.samples, s.evictions, double(s.bytes) / (1 << 20));
+}
+
+
+bool TrajectoryCache::interpolate(Track& track, double julianDate, State& state) {
+	Chunk* chunk = track.last;
+	if (!chunk || julianDate < chunk->times.front() || julianDate > chunk->times.back()) {
+		auto next = track.chunks.upper_bound(julianDate);
+		if (next == track.chunks.begin()) {
+			return false;
+		}
+		chunk = std::prev(next)->second.get();
+		if (julianDate > chunk->times.back()) {
+			return false;
+		}
+		track.last = chunk;
+		track.lastIndex = 0;
+	}
+
+	// Frames mostly ask for the same interval as the last, or the next one
+	const std::vector<double>& times = chunk->times;
+	size_t i = track.lastIndex;
+	if (julianDate < times[i] || julianDate > times[i + 1]) {
+		i = size_t(std::upper_bound(times.begin(), times.end(), julianDate) - times.begin());
+		i = std::min(std::max(i, size_t(1)), times.size() - 1) - 1;
+		track.lastIndex = i;
+	}
+	chunk->lastUsed = ++tick;
+
+	double h = times[i + 1] - times[i];
+	state = hermite(chunk->states[i], chunk->states[i + 1], h, (julianDate - times[i]) / h);
+	return true;
+}
+
+
+void TrajectoryCache::run() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wake.wait(lock, [this] { return stopping || playheadMoved; });
+		if (stopping) {
+			return;
+		}
+		playheadMoved = false;
+
+		// Ahead first: that is where the frames are going
+		double at = playhead;
+		double from = at - behind;
+		double to = at + ahead;
+		for (size_t i = 0; i < tracks.size() && !stopping; i++) {
+			fill(*tracks[i], at, to, lock);
+		}
+		for (size_t i = 0; i < tracks.size() && !stopping; i++) {
+			fill(*tracks[i], from, at, lock);
+		}
+	}
+}
+
+
+// Only this thread adds or removes chunks, so the track can be read without
+// the lock while the source is sampled
+void TrajectoryCache::fill(Track& track, double from, double to, std::unique_lock<std::mutex>& lock) {
+	double t = from;
+	while (t < to && !stopping) {
+		// Skip what is already sampled, and stop where the next chunk begins
+		auto next = track.chunks.upper_bound(t);
+		const Chunk* before = next != track.chunks.begin() ? std::prev(next)->second.get() : nullptr;
+		if (before && before->times.back() > t) {
+			t = before->times.back();
+			continue;
+		}
+		double boundary = next != track.chunks.end() ? next->first : std::numeric_limits<double>::infinity();
+
+		lock.unlock();
+
+		auto chunk = std::make_unique<Chunk>();
+		chunk->times.reserve(chunkSamples);
+		chunk->states.reserve(chunkSamples);
+		uint64_t calls = 0;
+
+		State a;
+		bool valid = true;
+		if (before && before->times.back() == t) {
+			a = before->states.back();
+		} else {
+			valid = track.source(t, a);
+			calls++;
+		}
+		if (valid) {
+			chunk->times.push_back(t);
+			chunk->states.push_back(a);
+		}
+
+		// Each step is checked against the source at its midpoint, where the
+		// interpolation error of a cubic is largest
+		while (valid && chunk->times.size() < chunkSamples && t < to && t < boundary) {
+			double h = std::min(track.step, boundary - t);
+			State b, middle;
+			valid = track.source(t + h, b) && track.source(t + 0.5 * h, middle);
+			calls += 2;
+			if (!valid) {
+				break;
+			}
+
+			double error = glm::length(hermite(a, b, h, 0.5).position - middle.position);
+			if (error > track.tolerance && h > track.minStep) {
+				track.step = std::max(0.5 * h, track.minStep);
+				continue;
+			}
+			if (error < track.tolerance / 32.0 && h == track.step) {
+				track.step = std::min(2.0 * h, track.maxStep);
+			}
+
+			t = h == boundary - t ? boundary : t + h;
+			a = b;
+			chunk->times.push_back(t);
+			chunk->states.push_back(a);
+		}
+
+		lock.lock();
+		counters.samples += calls;
+		if (!valid) {
+			// The source has no data at the next sample, e.g. before a kernel
+			// starts: step over it and keep filling the rest of the range
+			t += track.step;
+		}
+		if (chunk->times.size() < 2) {
+			continue;
+		}
+
+		size_t bytes = sizeof(Chunk) + chunk->times.capacity() * sizeof(double) + chunk->states.capacity() * sizeof(State);
+		chunk->lastUsed = tick;
+		const Chunk* added = chunk.get();
+		track.chunks.emplace(chunk->times.front(), std::move(chunk));
+		counters.bytes += bytes;
+		while (counters.bytes > memoryBudget && counters.bytes > bytes) {
+			evict(added);
+		}
+	}
+}
+
+
+// Drops the least recently used chunk of any track
+void TrajectoryCache::evict(const Chunk* keep) {
+	Track* oldestTrack = nullptr;
+	std::map<double, std::unique_ptr<Chunk>>::iterator oldest;
+	for (const auto& track : tracks) {
+		for (auto it = track->chunks.begin(); it != track->chunks.end(); ++it) {
+			if (it->second.get() != keep && (!oldestTrack || it->second->lastUsed < oldest->second->lastUsed)) {
+				oldestTrack = track.get();
+				oldest = it;
+			}
+		}
+	}
+	if (!oldestTrack) {
+		return;
+	}
+
+	const Chunk& chunk = *oldest->second;
+	counters.bytes -= sizeof(Chunk) + chunk.times.capacity() * sizeof(double) + chunk.states.capacity() * sizeof(State);
+	counters.evictions++;
+	if (oldestTrack->last == &chunk) {
+		oldestTrack->last = nullptr;
+		oldestTrack->lastIndex = 0;
+	}
+	oldestTrack->chunks.erase(oldest);
+}
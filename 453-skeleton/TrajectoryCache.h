@@ -0,0 +1,112 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a cache of sampled trajectories for costly sources.
+//
+// Each track wraps a source (SPK lookups, an integrator...) that gives a
+// state at any date. A background thread samples it ahead of the playhead at
+// intervals chosen so that cubic Hermite interpolation between samples stays
+// within the track's tolerance: every step is checked against the source at
+// its midpoint, halved while the check fails and doubled while it passes by
+// a wide margin. Queries then cost a lookup and a cubic, whatever the source.
+//
+// Samples are kept in chunks. When the chunks outgrow the memory budget the
+// least recently used are dropped. A query nothing covers calls the source
+// directly, so it is never wrong, only slower, and moves the playhead there.
+// Sources are called from the background thread and must be thread-safe.
+//------------------------------------------------------------------------------
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class TrajectoryCache {
+
+public:
+	// Any units, as long as velocity is position per day
+	struct State {
+		glm::dvec3 position;
+		glm::dvec3 velocity;
+	};
+
+	// False where the source has no data
+	using Source = std::function<bool(double julianDate, State& state)>;
+
+	struct Stats {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t samples = 0;		// source calls made filling
+		uint64_t evictions = 0;
+		size_t bytes = 0;
+	};
+
+	explicit TrajectoryCache(size_t memoryBudget = size_t(64) << 20);
+
+	// The worker thread would outlive the cache
+	TrajectoryCache(const TrajectoryCache&) = delete;
+	TrajectoryCache& operator=(const TrajectoryCache&) = delete;
+
+	~TrajectoryCache();
+
+	// Public interface
+	// tolerance is in position units; steps start at initialStep days and
+	// stay within [minStep, maxStep]
+	int addTrack(Source source, double tolerance, double initialStep, double minStep = 1e-4, double maxStep = 64.0);
+
+	// Interpolated where cached, from the source otherwise
+	bool state(int track, double julianDate, State& state);
+
+	// The worker keeps every track sampled over [julianDate - behind,
+	// julianDate + ahead], in days
+	void setPlayhead(double julianDate, double ahead, double behind = 1.0);
+
+	Stats stats() const;
+	void logSummary() const;
+
+private:
+	struct Chunk {
+		std::vector<double> times;
+		std::vector<State> states;
+		uint64_t lastUsed;
+	};
+
+	struct Track {
+		Source source;
+		double tolerance;
+		double step;
+		double minStep;
+		double maxStep;
+
+		// Keyed by first sample; chunks share their boundary samples
+		std::map<double, std::unique_ptr<Chunk>> chunks;
+		Chunk* last = nullptr;
+		size_t lastIndex = 0;
+	};
+
+	size_t memoryBudget;
+
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<std::unique_ptr<Track>> tracks;
+	double playhead;
+	double ahead;
+	double behind;
+	bool playheadMoved;
+	bool stopping;
+	uint64_t tick;
+	Stats counters;
+	std::thread worker;
+
+	void run();
+	void fill(Track& track, double from, double to, std::unique_lock<std::mutex>& lock);
+	bool interpolate(Track& track, double julianDate, State& state);
+	void evict(const Chunk* keep);
+};
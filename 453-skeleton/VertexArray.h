@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GLHandles.h"
+#include "GLState.h"
 
 #include <GL/glew.h>
 
@@ -18,7 +19,8 @@ public:
 	// https://github.com/isocpp/CppCoreGuidelines/blob/master/CppCoreGuidelines.md#Rc-zero
 
 	// Public interface
-	void bind() const { glBindVertexArray(arrayID); }
+	void bind() const { GLState::bindVertexArray(arrayID); }
+	GLuint id() const { return arrayID; }
 
 private:
 	VertexArrayHandle arrayID;
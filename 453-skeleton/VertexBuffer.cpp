@@ -1,10 +1,15 @@
 #include "VertexBuffer.h"
 
+#include "Profiler.h"
+#include "RenderStats.h"
+
 #include <utility>
 
 
 VertexBuffer::VertexBuffer(GLuint index, GLint size, GLenum dataType)
 	: bufferID{}
+	, capacity(0)
+	, usage(GL_NONE)
 {
 	bind();
 	glVertexAttribPointer(index, size, dataType, GL_FALSE, 0, (void*)0);
@@ -13,6 +18,16 @@ VertexBuffer::VertexBuffer(GLuint index, GLint size, GLenum dataType)
 
 
 void VertexBuffer::uploadData(GLsizeiptr size, const void* data, GLenum usage) {
-	bind();
-	glBufferData(GL_ARRAY_BUFFER, size, data, usage);
+	PROFILE_ZONE("upload");
+
+	if (size <= capacity && usage == this->usage) {
+		GLState::bufferSubData(bufferID, 0, size, data);
+	}
+	else {
+		GLState::bufferData(bufferID, size, data, usage);
+		capacity = size;
+		this->usage = usage;
+	}
+
+	RenderStats::countUpload(size);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GLHandles.h"
+#include "GLState.h"
 
 #include <GL/glew.h>
 
@@ -18,10 +19,13 @@ public:
 	// https://github.com/isocpp/CppCoreGuidelines/blob/master/CppCoreGuidelines.md#Rc-zero
 
 	// Public interface
-	void bind() const { glBindBuffer(GL_ARRAY_BUFFER, bufferID); }
+	void bind() const { GLState::bindBuffer(GL_ARRAY_BUFFER, bufferID); }
 	void uploadData(GLsizeiptr size, const void* data, GLenum usage);
 
 private:
 	VertexBufferHandle bufferID;
-};
 
+	// Storage is only reallocated when it grows or its usage changes
+	GLsizeiptr capacity;
+	GLenum usage;
+};
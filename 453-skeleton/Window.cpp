@@ -48,7 +48,7 @@ void Window::windowSizeMetaCallback(GLFWwindow* window, int width, int height) {
 
 Window::Window(
 	std::shared_ptr<CallbackInterface> callbacks, int width, int height,
-	const char* title, GLFWmonitor* monitor, GLFWwindow* share
+	const char* title, GLFWmonitor* monitor, GLFWwindow* share, ContextMode mode
 )
 	: window(nullptr)
 	, callbacks(callbacks)
@@ -58,7 +58,11 @@ Window::Window(
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // needed for mac?
-	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+
+	// a no-error context is ignored where the driver can't make one
+	bool diagnostic = mode == ContextMode::Diagnostic;
+	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, diagnostic ? GL_TRUE : GL_FALSE);
+	glfwWindowHint(GLFW_CONTEXT_NO_ERROR, diagnostic ? GLFW_FALSE : GLFW_TRUE);
 
 	// create window
 	window = std::unique_ptr<GLFWwindow, WindowDeleter>(glfwCreateWindow(width, height, title, monitor, share));
@@ -91,8 +95,8 @@ Window::Window(
 }
 
 
-Window::Window(int width, int height, const char* title, GLFWmonitor* monitor, GLFWwindow* share)
-	: Window(nullptr, width, height, title, monitor, share)
+Window::Window(int width, int height, const char* title, GLFWmonitor* monitor, GLFWwindow* share, ContextMode mode)
+	: Window(nullptr, width, height, title, monitor, share, mode)
 {}
 
 
@@ -5,6 +5,8 @@
 // interacting with a GLFW window following RAII principles
 //------------------------------------------------------------------------------
 
+#include "ContextMode.h"
+
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -44,9 +46,13 @@ class Window {
 public:
 	Window(
 		std::shared_ptr<CallbackInterface> callbacks, int width, int height,
-		const char* title, GLFWmonitor* monitor = NULL, GLFWwindow* share = NULL
+		const char* title, GLFWmonitor* monitor = NULL, GLFWwindow* share = NULL,
+		ContextMode mode = ContextMode::Diagnostic
+	);
+	Window(
+		int width, int height, const char* title, GLFWmonitor* monitor = NULL, GLFWwindow* share = NULL,
+		ContextMode mode = ContextMode::Diagnostic
 	);
-	Window(int width, int height, const char* title, GLFWmonitor* monitor = NULL, GLFWwindow* share = NULL);
 
 	void setCallbacks(std::shared_ptr<CallbackInterface> callbacks);
 
@@ -6,19 +6,52 @@
 #include <list>
 #include <vector>
 #include <limits>
+#include <chrono>
+#include <filesystem>
 #include <functional>
 #include <utility>
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+#include <map>
+#include <sstream>
 
 #include "Geometry.h"
+#include "AsteroidField.h"
+#include "Benchmark.h"
+#include "Ephemeris.h"
+#include "EventSearch.h"
 #include "GLDebug.h"
+#include "GLState.h"
+#include "GpuProfiler.h"
+#include "FrameCapture.h"
+#include "Framebuffer.h"
+#include "Frames.h"
+#include "HeadlessContext.h"
+#include "Kepler.h"
 #include "Log.h"
+#include "MinorPlanetCatalog.h"
+#include "OrbitRenderer.h"
+#include "PerfHud.h"
+#include "Profiler.h"
+#include "Projection.h"
+#include "RenderQueue.h"
+#include "SceneFile.h"
 #include "ShaderProgram.h"
 #include "Shader.h"
+#include "Skybox.h"
+#include "SpkEphemeris.h"
+#include "StarField.h"
+#include "StreamBuffer.h"
+#include "TrajectoryCache.h"
 #include "Texture.h"
 #include "Window.h"
 #include "Camera.h"
 
+#include <argh.h>
+
 #include "glm/glm.hpp"
+#include "glm/gtc/constants.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "glm/gtx/transform.hpp"
 
@@ -26,30 +59,19 @@
 #include "imgui/imgui_impl_glfw.h"
 #include "imgui/imgui_impl_opengl3.h"
 
-struct WorldObject
+// The unit sphere every body is drawn with. Bodies only differ in their
+// transform, texture and material, so they all share one copy.
+struct SphereMesh
 {
-
-    WorldObject(std::string texturePath, GLenum textureInterpolation) : texture(texturePath, textureInterpolation)
-    {
-    }
-
-    Texture texture;
-
     CPU_Geometry cgeom;
     GPU_Geometry ggeom;
 
     std::vector<glm::vec3> original_verts;
-    std::vector<glm::vec3> original_normals;
 
     // Standard PI value we'll use for angle/distance calculations
     float PI = 3.14159265359;
 
-    float scaling_factor = 1;
     int radius = 1;
-    float object_radius = radius * scaling_factor;
-    float angle = glm::radians(0.0f); // rotation of planet
-    float theta = 0.0f;
-    glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
 
     void generateSpheres()
     {
@@ -231,12 +253,22 @@ struct WorldObject
         cgeom.cols.resize(cgeom.verts.size(), glm::vec3(1.0f, 0.0f, 0.0f));
     }
 
-    void updateGPU()
+    // The mesh never changes after set up; everything per-frame is in the
+    // model matrix. Normals of a unit sphere are just its positions.
+    void uploadStatic()
     {
+        addCols();
+
+        std::vector<glm::vec3> normals(original_verts.size());
+        for (size_t i = 0; i < original_verts.size(); i++)
+        {
+            normals[i] = glm::normalize(original_verts[i]);
+        }
+
         ggeom.bind();
-        ggeom.setVerts(cgeom.verts);
+        ggeom.setVerts(original_verts);
         ggeom.setCols(cgeom.cols);
-        ggeom.setNormals(cgeom.normals);
+        ggeom.setNormals(normals);
         ggeom.setTextures(cgeom.textures);
     }
 
@@ -247,109 +279,10 @@ struct WorldObject
             original_verts.push_back(cgeom.verts[i]);
         }
 
-        for (int i = 0; i < cgeom.normals.size(); i++)
-        {
-            original_normals.push_back(cgeom.normals[i]);
-        }
-
         straightenGlobe();
         axialTilt();
     }
 
-    void centerSpace()
-    {
-        float a = glm::radians(0.0f);
-        float b = glm::radians(0.0f);
-
-        glm::mat4 z_rotation{
-            cosf(a), sinf(a), 0.0f, 0.0f,
-            -sinf(a), cosf(a), 0.0f, 0.0f,
-            0.0f, 0.0f, 1.0f, 0.0f,
-            0.0f, 0.0f, 0.0f, 1.0f};
-
-        glm::mat4 x_rotation{
-            1.0f, 0.0f, 0.0f, 0.0f,
-            0.0f, cosf(b), sinf(b), 0.0f,
-            0.0f, -sinf(b), cosf(b), 0.0f,
-            0.0f, 0.0f, 0.0f, 1.0f};
-
-        for (int i = 0; i < original_verts.size(); i++)
-        {
-            original_verts[i] = z_rotation * x_rotation * glm::vec4(original_verts[i], 1.0f);
-        }
-    }
-
-    void updateNormals()
-    {
-        float length_normaliser = 1.0f / object_radius;
-
-        for (int i = 0; i < cgeom.normals.size(); i++)
-        {
-            cgeom.normals[i] = glm::vec3(cgeom.verts[i].x * length_normaliser, cgeom.verts[i].y * length_normaliser, cgeom.verts[i].z * length_normaliser);
-        }
-    }
-
-    void transformVerts()
-    {
-        glm::mat4 scaling {
-            scaling_factor, 0.0f, 0.0f, 0.0f,
-            0.0f, scaling_factor, 0.0f, 0.0f,
-            0.0f, 0.0f, scaling_factor, 0.0f,
-            0.0f, 0.0f, 0.0f, 1.0f};
-
-        glm::mat4 rotation {
-            cosf(angle), 0.0f, -sinf(angle), 0.0f,
-            0.0f, 1.0f, 0.0f, 0.0f,
-            sinf(angle), 0.0f, cosf(angle), 0.0f,
-            0.0f, 0.0f, 0.0f, 1.0f};
-
-        glm::mat4 test = glm::mat4(1.0f);
-
-        glm::mat4 translation {
-            1.0f, 0.0f, 0.0f, 0.0f,
-            0.0f, 1.0f, 0.0f, 0.0f,
-            0.0f, 0.0f, 1.0f, 0.0f,
-            position.x, position.y, position.z, 1.0f};
-
-        for (int i = 0; i < cgeom.verts.size(); i++)
-        {
-            cgeom.verts[i] = translation * (rotation * (scaling * glm::vec4(original_verts[i], 1.0f)));
-        }
-
-        glm::mat4 reverse_rotation{
-            cosf(-angle), 0.0f, -sinf(-angle), 0.0f,
-            0.0f, 1.0f, 0.0f, 0.0f,
-            sinf(-angle), 0.0f, cosf(-angle), 0.0f,
-            0.0f, 0.0f, 0.0f, 1.0f};
-
-        for (int i = 0; i < cgeom.verts.size(); i++)
-        {
-            cgeom.normals[i] = reverse_rotation * (glm::vec4(original_normals[i], 1.0f));
-        }
-
-        updateNormals();
-        addCols();
-        updateGPU();
-    }
-
-    void transformSun()
-    {
-        glm::mat4 scaling{
-            scaling_factor, 0.0f, 0.0f, 0.0f,
-            0.0f, scaling_factor, 0.0f, 0.0f,
-            0.0f, 0.0f, scaling_factor, 0.0f,
-            0.0f, 0.0f, 0.0f, 1.0f};
-
-        for (int i = 0; i < cgeom.verts.size(); i++)
-        {
-            cgeom.verts[i] = scaling * glm::vec4(original_verts[i], 1.0f);
-        }
-
-        updateNormals();
-        addCols();
-        updateGPU();
-    }
-
     void straightenGlobe()
     {
         float a = glm::radians(75.0f);
@@ -371,8 +304,6 @@ struct WorldObject
         {
             original_verts[i] = x_rotation * z_rotation * glm::vec4(original_verts[i], 1.0f);
         }
-
-        updateNormals();
     }
 
     void axialTilt()
@@ -396,8 +327,86 @@ struct WorldObject
         {
             original_verts[i] = z_rotation_1 * x_rotation * glm::vec4(original_verts[i], 1.0f);
         }
+    }
+};
+
+struct WorldObject
+{
+
+    WorldObject(std::string name, std::shared_ptr<SphereMesh> mesh, std::shared_ptr<Texture> texture)
+        : name(std::move(name)), mesh(std::move(mesh)), texture(std::move(texture))
+    {
+    }
+
+    std::string name;
+    std::shared_ptr<SphereMesh> mesh;
+    std::shared_ptr<Texture> texture;
+
+    float scaling_factor = 1;
+    float angle = glm::radians(0.0f); // rotation of planet
+    float theta = 0.0f;
+    float spin = 0.0f;
+    float ambient = 0.12f;
+    WorldObject *revolves_about = nullptr;
+    WorldObject *parent = nullptr;
+    int ephemeris = -1; // Ephemeris::Body it follows, or -1
+    bool follows_spk = false;
+    int naif_id = 0;
+    int trajectory = -1; // TrajectoryCache track sampling the SPK kernels
+    float ephemeris_scale = 1.0f;
+    double elements[6] = {}; // a, e, i, node, periapsis, mean anomaly; a is 0 unless placed by elements
+    int orbit_path = -1;     // its OrbitRenderer orbit, or -1
+
+    // Simulation state is kept in double precision; see modelMatrix
+    glm::dvec3 position = glm::dvec3(0.0, 0.0, 0.0);
+
+    // Built relative to the eye in double precision, so the float matrix the
+    // GPU sees only holds small numbers no matter how far out the body is
+    glm::mat4 modelMatrix(const glm::dvec3 &eye) const
+    {
+        glm::dmat4 translation = glm::translate(position - eye);
+        glm::dmat4 rotation = glm::rotate(double(angle), glm::dvec3(0.0, 1.0, 0.0));
+        glm::dmat4 scaling = glm::scale(glm::dvec3(scaling_factor));
+
+        return glm::mat4(translation * rotation * scaling);
+    }
+
+    // Uploads this frame's transforms and queues the draw; nothing is drawn
+    // until the queue executes
+    void submit(RenderQueue &queue, StreamBuffer &stream, const glm::dvec3 &eye, GLint uniformAlignment,
+                GLuint program, const char *name)
+    {
+        // Per-object block, see the Object block in test.vert
+        struct
+        {
+            glm::mat4 M;
+            glm::mat4 N;
+            glm::vec4 material;
+        } object;
+        {
+            PROFILE_ZONE("transform");
+            object.M = modelMatrix(eye);
+            object.N = glm::mat4(glm::transpose(glm::inverse(glm::mat3(object.M))));
+            object.material = glm::vec4(ambient, 0.0f, 0.0f, 0.0f);
+        }
 
-        updateNormals();
+        RenderQueue::Packet packet;
+        {
+            PROFILE_ZONE("upload");
+            StreamBuffer::Allocation allocation = stream.write(&object, sizeof(object), uniformAlignment);
+            packet.uniformBuffer = stream.id();
+            packet.uniformOffset = allocation.offset;
+            packet.uniformSize = allocation.size;
+        }
+
+        float distance = float(glm::length(position - eye));
+        packet.key = RenderQueue::makeKey(RenderQueue::Pass::Opaque, program, texture->id(), mesh->ggeom.vertexArray(), distance);
+        packet.name = name;
+        packet.program = program;
+        packet.vertexArray = mesh->ggeom.vertexArray();
+        packet.texture = texture->id();
+        packet.count = GLsizei(mesh->original_verts.size());
+        queue.submit(std::move(packet));
     }
 
     void continueRotation(int speed, float differential)
@@ -405,28 +414,41 @@ struct WorldObject
         angle += (2 * speed * differential * -0.0053);
     }
 
-    void continueOrbit(glm::vec3 orbitting, int pace)
+    // Mean motion follows Kepler's third law, at continueOrbit's pace for a = 1
+    void continueElements(int pace)
+    {
+        double a = elements[0];
+        elements[5] = std::remainder(elements[5] + pace * 0.005 / (a * std::sqrt(a)), glm::two_pi<double>());
+    }
+
+    void followElements()
+    {
+        glm::dvec3 origin = parent ? parent->position : glm::dvec3(0.0);
+        position = origin + Kepler::position(elements[0], elements[1], elements[2], elements[3], elements[4], elements[5]);
+    }
+
+    void continueOrbit(glm::dvec3 orbitting, int pace)
     {  
 
-        float speed = pace * 0.005;
-        glm::vec3 dist = glm::vec3(0.0f, 0.0f, 0.0f) - orbitting;
+        double speed = pace * 0.005;
+        glm::dvec3 dist = glm::dvec3(0.0, 0.0, 0.0) - orbitting;
 
-        glm::mat4 translateToOrigin{
-            1.0f, 0.0f, 0.0f, 0.0f,
-            0.0f, 1.0f, 0.0f, 0.0f,
-            0.0f, 0.0f, 1.0f, 0.0f,
-            (-dist.x * 0.25), (-dist.y * 0.25), (-dist.z * 0.25), 1.0f};
+        glm::dmat4 translateToOrigin{
+            1.0, 0.0, 0.0, 0.0,
+            0.0, 1.0, 0.0, 0.0,
+            0.0, 0.0, 1.0, 0.0,
+            (-dist.x * 0.25), (-dist.y * 0.25), (-dist.z * 0.25), 1.0};
 
-        position = translateToOrigin * glm::vec4(position, 1.0f);
-        position = glm::vec3(((position.x * cosf(speed)) - (position.y * sinf(speed))), ((position.x * sinf(speed)) + (position.y * cosf(speed))), position.z);
+        position = translateToOrigin * glm::dvec4(position, 1.0);
+        position = glm::dvec3(((position.x * cos(speed)) - (position.y * sin(speed))), ((position.x * sin(speed)) + (position.y * cos(speed))), position.z);
 
-        glm::mat4 translateBack{
-            1.0f, 0.0f, 0.0f, 0.0f,
-            0.0f, 1.0f, 0.0f, 0.0f,
-            0.0f, 0.0f, 1.0f, 0.0f,
-            (dist.x * 0.25), (dist.y * 0.25), (dist.z * 0.25), 1.0f};
+        glm::dmat4 translateBack{
+            1.0, 0.0, 0.0, 0.0,
+            0.0, 1.0, 0.0, 0.0,
+            0.0, 0.0, 1.0, 0.0,
+            (dist.x * 0.25), (dist.y * 0.25), (dist.z * 0.25), 1.0};
 
-        position = translateBack * glm::vec4(position, 1.0f);
+        position = translateBack * glm::dvec4(position, 1.0);
 
     }
 };
@@ -436,17 +458,91 @@ struct Movement
     bool earth_rotation = true;
     bool orbital_rotation = false;
     int speed = 1;
+    int focus = 0; // index of the body the camera is centred on
+    bool gpu_profiler = false;
+    bool write_trace = false;
+    bool perf_hud = false;
+    bool next_eclipse = false;
 };
 
-void orbitalInclination(WorldObject& ref, WorldObject& subject, float dist, float pitch, float yaw)
+void orbitalInclination(WorldObject& ref, WorldObject& subject, double dist, double pitch, double yaw)
 {
-    float x = sinf(yaw) * cosf(pitch);
-    float y = sinf(pitch);
-    float z = cosf(yaw) * cosf(pitch);
+    double x = sin(yaw) * cos(pitch);
+    double y = sin(pitch);
+    double z = cos(yaw) * cos(pitch);
+
+    subject.position = glm::dvec3(ref.position.x + (dist * x), ref.position.x + (dist * y), ref.position.x + (dist * z));
+}
 
-    subject.position = glm::vec3(ref.position.x + (dist * x), ref.position.x + (dist * y), ref.position.x + (dist * z));
+// Places a body at its offset from its parent's ephemeris body (the Sun when
+// the parent has none), scaled so moons can be pulled clear of their planets
+void followEphemeris(WorldObject &body, const glm::dvec3 heliocentric[Ephemeris::bodyCount])
+{
+    glm::dvec3 origin(0.0);
+    glm::dvec3 reference = heliocentric[int(Ephemeris::Body::Sun)];
+    if (body.parent)
+    {
+        origin = body.parent->position;
+        if (body.parent->ephemeris >= 0)
+        {
+            reference = heliocentric[body.parent->ephemeris];
+        }
+    }
+    body.position = origin + double(body.ephemeris_scale) * (heliocentric[body.ephemeris] - reference);
 }
 
+// The NAIF body an SPK body is placed relative to: its parent's, or the Sun
+int spkCenter(const WorldObject &body)
+{
+    if (body.parent && body.parent->follows_spk)
+    {
+        return body.parent->naif_id;
+    }
+    if (body.parent && body.parent->ephemeris >= 0)
+    {
+        return Ephemeris::naifId(Ephemeris::Body(body.parent->ephemeris));
+    }
+    return 10;
+}
+
+// The same from SPK kernels, through the trajectory cache; bodies stay where
+// they are while the kernels don't cover the date
+void followSpk(WorldObject &body, TrajectoryCache &trajectories, double julianDate)
+{
+    glm::dvec3 origin = body.parent ? body.parent->position : glm::dvec3(0.0);
+    TrajectoryCache::State state;
+    if (trajectories.state(body.trajectory, julianDate, state))
+    {
+        body.position = origin + double(body.ephemeris_scale) * state.position;
+    }
+}
+
+// continueOrbit spins bodies about the z axis, so their paths are circles
+// parallel to the xy plane at the body's current height
+OrbitRenderer::Orbit circularOrbit(const WorldObject& body, glm::vec3 color)
+{
+    OrbitRenderer::Orbit orbit{};
+    orbit.center = glm::dvec3(0.0, 0.0, body.position.z);
+    orbit.semiMajorAxis = float(glm::length(glm::dvec2(body.position.x, body.position.y)));
+    orbit.color = color;
+    return orbit;
+}
+
+// What the renderers that draw themselves need for one frame. Render queue
+// packets carry a pointer to it, so handing over to them doesn't allocate.
+struct SelfDrawn
+{
+    OrbitRenderer *orbits;
+    AsteroidField *asteroids;
+    Skybox *skybox;
+    StarField *stars;
+    glm::mat4 V;
+    glm::mat4 P;
+    glm::ivec2 viewport;
+    glm::dvec3 eye;
+    glm::dvec3 sun;
+};
+
 // EXAMPLE CALLBACKS
 class Assignment4 : public CallbackInterface
 {
@@ -468,6 +564,31 @@ public:
             system.orbital_rotation = !system.orbital_rotation;
         }
 
+        if (key >= GLFW_KEY_1 && key <= GLFW_KEY_9 && action == GLFW_PRESS)
+        {
+            system.focus = key - GLFW_KEY_1;
+        }
+
+        if (key == GLFW_KEY_G && action == GLFW_PRESS)
+        {
+            system.gpu_profiler = !system.gpu_profiler;
+        }
+
+        if (key == GLFW_KEY_H && action == GLFW_PRESS)
+        {
+            system.perf_hud = !system.perf_hud;
+        }
+
+        if (key == GLFW_KEY_T && action == GLFW_PRESS)
+        {
+            system.write_trace = true;
+        }
+
+        if (key == GLFW_KEY_N && action == GLFW_PRESS)
+        {
+            system.next_eclipse = true;
+        }
+
         if (key == GLFW_KEY_DOWN && action == GLFW_PRESS)
         {
             if(system.speed > 1) system.speed -= 1;
@@ -515,19 +636,23 @@ public:
         aspect = float(width) / float(height);
     }
 
+    glm::mat4 getProjection()
+    {
+        return Projection::perspective(glm::radians(45.0f), aspect, 0.01f);
+    }
+
+    // Everything is rendered relative to the eye, so the light that
+    // follows the camera sits at the origin
     void viewPipeline(ShaderProgram &sp)
     {
-        glm::mat4 M = glm::mat4(1.0);
         glm::mat4 V = camera.getView();
-        glm::mat4 P = glm::perspective(glm::radians(45.0f), aspect, 0.01f, 1000.f);
+        glm::mat4 P = getProjection();
 
         GLint location = glGetUniformLocation(sp, "light");
-        glm::vec3 light = camera.getPos();
+        glm::vec3 light = glm::vec3(0.0f, 0.0f, 0.0f);
         glUniform3fv(location, 1, glm::value_ptr(light));
 
-        GLint uniMat = glGetUniformLocation(sp, "M");
-        glUniformMatrix4fv(uniMat, 1, GL_FALSE, glm::value_ptr(M));
-        uniMat = glGetUniformLocation(sp, "V");
+        GLint uniMat = glGetUniformLocation(sp, "V");
         glUniformMatrix4fv(uniMat, 1, GL_FALSE, glm::value_ptr(V));
         uniMat = glGetUniformLocation(sp, "P");
         glUniformMatrix4fv(uniMat, 1, GL_FALSE, glm::value_ptr(P));
@@ -544,165 +669,732 @@ private:
 };
 
 
-int main()
+int main(int argc, char *argv[])
 {
     Log::debug("Starting main");
 
+    // --headless draws --frames frames into an EGL context instead of a
+    // window, for machines with no display or GPU. --capture writes every
+    // frame into a directory as png (default) or raw --capture-format.
+    // --benchmark runs a script and writes its timings to --benchmark-out.
+    // --log-file copies the log into a file. --gl-mode picks a release or
+    // diagnostic context (see ContextMode.h). In diagnostic mode --gl-sync
+    // makes GL debug output synchronous and --gl-severity (high/medium/low)
+    // hides quieter messages. --asteroids adds a GPU-culled asteroid belt.
+    // --scene loads the bodies from a scene file (see SceneFile.h).
+    // --minor-planets draws an MPCORB catalog in place of that belt.
+    // --ephemeris moves bodies by a converted JPL ephemeris from --epoch,
+    // --spk by a comma separated list of SPK kernels.
+    argh::parser cmdl;
+    cmdl.add_params({"width", "height", "frames", "capture", "capture-format", "benchmark", "benchmark-out", "log-file", "gl-mode", "gl-severity", "asteroids", "scene", "minor-planets", "ephemeris", "epoch", "spk"});
+    cmdl.parse(argc, argv);
+
+    std::string logFile;
+    if (cmdl("log-file") >> logFile && !Log::setFile(logFile))
+    {
+        Log::warn("Unable to open log file {}", logFile);
+    }
+
+    bool headless = cmdl["headless"];
+    int width, height, frameCount;
+    cmdl("width", 800) >> width;
+    cmdl("height", 800) >> height;
+    cmdl("frames", 600) >> frameCount;
+
+    ContextMode contextMode = defaultContextMode();
+    std::string contextModeArgument;
+    if (cmdl("gl-mode") >> contextModeArgument)
+    {
+        contextMode = parseContextMode(contextModeArgument);
+    }
+
     // WINDOW
-    glfwInit();
-    Window window(800, 800, "CPSC 453-Assignment 4"); // can set callbacks at construction if desired
+    std::unique_ptr<Window> window;
+    std::unique_ptr<HeadlessContext> offscreen;
+    if (headless)
+    {
+        offscreen = std::make_unique<HeadlessContext>(width, height, contextMode);
+    }
+    else
+    {
+        glfwInit();
+        window = std::make_unique<Window>(width, height, "CPSC 453-Assignment 4", nullptr, nullptr, contextMode); // can set callbacks at construction if desired
+    }
+
+    // Input comes from the script instead, and vsync would cap the results
+    std::unique_ptr<Benchmark> benchmark;
+    std::string benchmarkScript;
+    if (cmdl("benchmark") >> benchmarkScript)
+    {
+        benchmark = std::make_unique<Benchmark>(benchmarkScript);
+        if (window)
+        {
+            glfwSwapInterval(0);
+        }
+    }
+    auto drawableSize = [&]() { return window ? window->getSize() : offscreen->getSize(); };
+
+    GLint contextFlags = 0;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &contextFlags);
+    Log::info("CONTEXT {} mode, {}", contextModeName(contextMode),
+              contextFlags & GL_CONTEXT_FLAG_NO_ERROR_BIT_KHR ? "no-error" :
+              contextFlags & GL_CONTEXT_FLAG_DEBUG_BIT ? "debug" : "default error checking");
+
+    // Validation, labels and debug groups cost driver time, so only
+    // diagnostic runs pay for them
+    if (contextMode == ContextMode::Diagnostic)
+    {
+        std::string glSeverity;
+        cmdl("gl-severity", "notification") >> glSeverity;
+        GLDebug::setMinimumSeverity(
+            glSeverity == "high" ? GL_DEBUG_SEVERITY_HIGH :
+            glSeverity == "medium" ? GL_DEBUG_SEVERITY_MEDIUM :
+            glSeverity == "low" ? GL_DEBUG_SEVERITY_LOW : GL_DEBUG_SEVERITY_NOTIFICATION);
+        GLDebug::enable(cmdl["gl-sync"]);
+        GLDebug::enableLabels();
+        Profiler::enableGpuMarkers();
+    }
+    Projection::enableReversedZ();
+    Profiler::setThreadName("main");
 
-    GLDebug::enable();
+    // Before any GL object is created, the handles depend on it. State that
+    // never changes is set once here rather than every frame.
+    GLState::init();
+    glEnable(GL_LINE_SMOOTH);
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glClearDepth(Projection::clearDepth());
 
     Movement solar_system;
 
     // CALLBACKS
     auto a4 = std::make_shared<Assignment4>(solar_system);
-    window.setCallbacks(a4);
+    a4->windowSizeCallback(width, height);
+    if (window && !benchmark)
+    {
+        window->setCallbacks(a4);
+    }
 
     ShaderProgram shader("shaders/test.vert", "shaders/test.frag");
 
-    WorldObject earth("textures/earth.png", GL_LINEAR);
-    WorldObject moon("textures/moon.png", GL_LINEAR);
-    WorldObject sun("textures/sun.png", GL_LINEAR);
-    WorldObject space("textures/space.png", GL_LINEAR);
+    // Per-object matrices are streamed into a uniform block at binding 0
+    glUniformBlockBinding(shader, glGetUniformBlockIndex(shader, "Object"), 0);
+    GLint uniformAlignment;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+
+    // Bodies come from the scene file; see SceneFile.h for the format
+    std::string scenePath;
+    cmdl("scene", "scenes/solar_system.txt") >> scenePath;
+    auto sceneStart = std::chrono::steady_clock::now();
+    SceneFile scene(scenePath);
+
+    auto sphere = std::make_shared<SphereMesh>();
+    sphere->generateSpheres();
+    sphere->backUpCoords();
+    sphere->uploadStatic();
+
+    // Bodies sharing a texture share the GL texture too
+    std::map<std::pair<std::string, GLenum>, std::shared_ptr<Texture>> textures;
+    std::vector<std::unique_ptr<WorldObject>> bodies;
+    std::vector<OrbitRenderer::Orbit> orbitPaths;
+    bodies.reserve(scene.size());
+
+    // With an ephemeris, bodies that name one of its bodies follow it from
+    // --epoch (a Julian date) on; without, they fall back to place/elements
+    std::unique_ptr<Ephemeris> ephemeris;
+    double julianDate = Frames::j2000;
+    bool dated = bool(cmdl("epoch") >> julianDate);
+    glm::dvec3 heliocentric[Ephemeris::bodyCount];
+    std::string ephemerisPath;
+    if (cmdl("ephemeris") >> ephemerisPath)
+    {
+        try
+        {
+            ephemeris = std::make_unique<Ephemeris>(ephemerisPath);
+            julianDate = std::clamp(julianDate, ephemeris->startJD(), ephemeris->endJD());
+            ephemeris->allHeliocentricEcliptic(julianDate, heliocentric);
+        }
+        catch (std::runtime_error &e)
+        {
+            Log::warn("No ephemeris: {}", e.what());
+            ephemeris.reset();
+        }
+    }
+
+    // SPK kernels, comma separated, later ones taking precedence. Loading
+    // only reads their summaries; segments are read once a body needs them.
+    std::unique_ptr<SpkEphemeris> spk;
+    std::string spkPaths;
+    if (cmdl("spk") >> spkPaths)
+    {
+        spk = std::make_unique<SpkEphemeris>();
+        std::stringstream list(spkPaths);
+        std::string kernel;
+        while (std::getline(list, kernel, ','))
+        {
+            try
+            {
+                spk->load(kernel);
+            }
+            catch (std::runtime_error &e)
+            {
+                Log::warn("Skipping SPK kernel {}: {}", kernel, e.what());
+            }
+        }
+        if (spk->kernelCount() == 0)
+        {
+            spk.reset();
+        }
+    }
+
+    // SPK bodies are sampled ahead of the date on a background thread and
+    // interpolated in between, so frames don't pay for kernel lookups
+    std::unique_ptr<TrajectoryCache> trajectories;
+    if (spk)
+    {
+        trajectories = std::make_unique<TrajectoryCache>();
+    }
+
+    for (size_t i = 0; i < scene.size(); i++)
+    {
+        const SceneFile::BodyRecord &record = scene.body(i);
+
+        GLenum filter = record.flags & SceneFile::NearestFilter ? GL_NEAREST : GL_LINEAR;
+        std::shared_ptr<Texture> &texture = textures[{scene.string(record.texture), filter}];
+        if (!texture)
+        {
+            texture = std::make_shared<Texture>(scene.string(record.texture), filter);
+        }
+
+        auto body = std::make_unique<WorldObject>(scene.string(record.name), sphere, texture);
+        body->scaling_factor = record.radius;
+        body->spin = record.spin;
+        body->ambient = record.ambient;
+
+        // Parents come first in the file, so they are already placed
+        WorldObject *parent = record.parent >= 0 ? bodies[record.parent].get() : nullptr;
+        body->parent = parent;
+        if (spk && (record.flags & SceneFile::FollowsSpk))
+        {
+            body->follows_spk = true;
+            body->naif_id = record.naifId;
+            body->ephemeris_scale = record.ephemerisScale;
+
+            // Kilometres on J2000 axes to AU on ecliptic axes, within 15 km
+            int target = record.naifId;
+            int center = spkCenter(*body);
+            body->trajectory = trajectories->addTrack([&spk = *spk, target, center](double jd, TrajectoryCache::State &state)
+            {
+                SpkEphemeris::State kilometres;
+                if (!spk.tryState(target, center, Frames::secondsPastJ2000(jd), kilometres))
+                {
+                    return false;
+                }
+                state.position = Frames::equatorialToEcliptic(kilometres.position / Frames::auKilometres);
+                state.velocity = Frames::equatorialToEcliptic(kilometres.velocity * (Frames::secondsPerDay / Frames::auKilometres));
+                return true;
+            }, 1e-7, 0.25);
+            followSpk(*body, *trajectories, julianDate);
+        }
+        else if (ephemeris && record.ephemeris >= 0)
+        {
+            body->ephemeris = record.ephemeris;
+            body->ephemeris_scale = record.ephemerisScale;
+            followEphemeris(*body, heliocentric);
+        }
+        else if (record.flags & SceneFile::HasElements)
+        {
+            std::copy(record.elements, record.elements + 6, body->elements);
+            body->followElements();
+        }
+        else if (parent)
+        {
+            orbitalInclination(*parent, *body, record.distance, record.pitch, record.yaw);
+        }
+
+        // Bodies on an ephemeris or kernel follow neither a fixed ellipse nor
+        // continueOrbit's circle, so there is no path to draw for them
+        if ((record.flags & SceneFile::HasOrbitPath) && (body->ephemeris >= 0 || body->follows_spk))
+        {
+            Log::info("SCENE {} follows an ephemeris, its orbit_path is not drawn", body->name);
+        }
+        else if (record.flags & SceneFile::HasOrbitPath)
+        {
+            glm::vec3 color(record.orbitColor[0], record.orbitColor[1], record.orbitColor[2]);
+            if (record.flags & SceneFile::HasElements)
+            {
+                OrbitRenderer::Orbit orbit{};
+                orbit.center = parent ? parent->position : glm::dvec3(0.0);
+                orbit.semiMajorAxis = record.elements[0];
+                orbit.eccentricity = record.elements[1];
+                orbit.inclination = record.elements[2];
+                orbit.ascendingNode = record.elements[3];
+                orbit.argumentOfPeriapsis = record.elements[4];
+                orbit.color = color;
+                body->orbit_path = int(orbitPaths.size());
+                orbitPaths.push_back(orbit);
+            }
+            else
+            {
+                orbitPaths.push_back(circularOrbit(*body, color));
+            }
+        }
+        bodies.push_back(std::move(body));
+    }
+
+    // May refer to bodies further down the file
+    for (size_t i = 0; i < scene.size(); i++)
+    {
+        int32_t about = scene.body(i).revolvesAbout;
+        bodies[i]->revolves_about = about >= 0 ? bodies[about].get() : nullptr;
+    }
+    Log::info("SCENE {} bodies, {} textures, ready in {:.1f} ms", bodies.size(), textures.size(),
+              std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sceneStart).count());
+
+    if (benchmark)
+    {
+        benchmark->checkFocus(bodies.size());
+    }
+
+    // The background is a cube map at infinity rather than a huge sphere
+    Skybox skybox("textures/space.png");
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    // The star catalog is optional; build one with tools/starconv. Only a
+    // catalog that is there but can't be read is worth an error.
+    std::unique_ptr<StarField> stars;
+    if (!std::filesystem::exists("catalogs/stars.bin"))
+    {
+        Log::info("No star catalog loaded, drawing the background only");
+    }
+    else
+    {
+        try
+        {
+            stars = std::make_unique<StarField>("catalogs/stars.bin");
+        }
+        catch (std::runtime_error &e)
+        {
+            Log::warn("No star catalog: {}", e.what());
+        }
+    }
+
+    // An optional belt of small bodies, culled and drawn entirely on the GPU.
+    // Real minor planets replace the generated belt when given a catalog.
+    std::unique_ptr<AsteroidField> asteroids;
+    uint32_t asteroidCount = 0;
+    std::string minorPlanets;
+    if (cmdl("minor-planets") >> minorPlanets)
+    {
+        try
+        {
+            // Placed at the date the planets are at, when there is one
+            MinorPlanetCatalog catalog(minorPlanets);
+            bool planetsDated = dated || ephemeris || spk;
+            asteroids = std::make_unique<AsteroidField>(catalog, planetsDated ? julianDate : catalog.latestEpoch());
+        }
+        catch (std::runtime_error &e)
+        {
+            Log::warn("No minor planets: {}", e.what());
+        }
+    }
+    else if ((cmdl("asteroids", 0) >> asteroidCount) && asteroidCount > 0)
+    {
+        try
+        {
+            asteroids = std::make_unique<AsteroidField>(asteroidCount);
+        }
+        catch (std::runtime_error &e)
+        {
+            Log::warn("No asteroid belt: {}", e.what());
+        }
+    }
+
+    // Orbits are set up once; only their eye-relative centres change between frames
+    OrbitRenderer orbits;
+    orbits.setOrbits(orbitPaths);
+
+    // Per-frame object data for every body lives in one persistently mapped ring
+    StreamBuffer stream(1024 * 1024);
 
-    sun.generateSpheres();
-    sun.backUpCoords();
-    sun.scaling_factor = 0.15f;
 
-    earth.generateSpheres();
-    earth.backUpCoords();
-    earth.scaling_factor = 0.017;
-    float earth_distance_from_sun = 1.0f;
-    orbitalInclination(sun, earth, earth_distance_from_sun, -25, -25);
+    // The scene is drawn offscreen for its floating point depth buffer
+    Framebuffer framebuffer(width, height);
 
-    moon.generateSpheres();
-    moon.backUpCoords();
-    moon.scaling_factor = 0.0085;
-    float moon_distance_from_earth = 0.6f;
-    orbitalInclination(earth, moon, moon_distance_from_earth, -25, -25);
+    // GPU time per pass, read back a few frames late so it never stalls
+    GpuProfiler profiler;
 
-    space.generateSpheres();
-    space.backUpCoords();
-    space.centerSpace();
-    space.scaling_factor = 4.0f;
+    // Everything drawn in the scene goes through here, sorted by state
+    RenderQueue queue;
+
+    // Image sequence export, read back a few frames late so it never stalls
+    std::unique_ptr<FrameCapture> capture;
+    std::string captureDirectory;
+    if (cmdl("capture") >> captureDirectory)
+    {
+        std::string captureFormat;
+        cmdl("capture-format", "png") >> captureFormat;
+        capture = std::make_unique<FrameCapture>(captureDirectory, FrameCapture::parseFormat(captureFormat));
+    }
+
+    // Frame times and render counters, shown with H
+    PerfHud hud;
+    auto lastFrame = std::chrono::steady_clock::now();
 
     // RENDER LOOP
-    while (!window.shouldClose())
+    int frame = 0;
+    auto running = [&]()
+    {
+        if (benchmark)
+        {
+            return !benchmark->isDone() && !(window && window->shouldClose());
+        }
+        return window ? !window->shouldClose() : frame < frameCount;
+    };
+    while (running())
     {
-        glfwPollEvents();
+        PROFILE_ZONE("frame");
 
-        glEnable(GL_LINE_SMOOTH);
-        glEnable(GL_FRAMEBUFFER_SRGB);
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        // the counters cover everything since the last swap. Before the
+        // first frame there was only setup, so that gap isn't a frame time.
+        auto now = std::chrono::steady_clock::now();
+        RenderStats::Counters counters = RenderStats::nextFrame();
+        if (frame > 0)
+        {
+            hud.addFrame(std::chrono::duration<float, std::milli>(now - lastFrame).count(), counters);
+        }
+        hud.setDebugMessages(GLDebug::nextFrame());
+        lastFrame = now;
+
+        if (window)
+        {
+            glfwPollEvents();
+        }
+        stream.beginFrame();
+        profiler.beginFrame();
+
+        glm::ivec2 size = drawableSize();
+        framebuffer.resize(size.x, size.y);
+        framebuffer.bind();
+
+        GLState::enable(GL_FRAMEBUFFER_SRGB);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glEnable(GL_DEPTH_TEST);
+        GLState::enable(GL_DEPTH_TEST);
+        GLState::depthFunc(Projection::depthFunc());
 
         // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
         // glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-        a4->viewPipeline(shader);
+        if (benchmark)
+        {
+            Benchmark::CameraPose pose = benchmark->getCamera();
+            a4->camera.setSpherical(pose.theta, pose.phi, pose.radius);
+
+            Benchmark::SimulationState state = benchmark->getSimulation();
+            solar_system.earth_rotation = state.earthRotation;
+            solar_system.orbital_rotation = state.orbitalRotation;
+            solar_system.speed = state.speed;
+            solar_system.focus = state.focus;
+        }
 
+        // Rebase the world on the eye once per frame, in double precision
+        int focus = std::clamp(solar_system.focus, 0, int(bodies.size()) - 1);
+        a4->camera.setTarget(bodies[focus]->position);
+        glm::dvec3 eye = a4->camera.getPosition();
+
+        // the orbit and skybox passes switch programs, so bind ours
+        // before setting its uniforms
         shader.use();
+        a4->viewPipeline(shader);
 
-        // space drawing
-        space.transformSun();
-        space.ggeom.bind();
+        for (const auto &body : bodies)
+        {
+            body->submit(queue, stream, eye, uniformAlignment, shader, "bodies");
+        }
 
-        space.texture.bind();
-        glDrawArrays(GL_TRIANGLES, 0, GLsizei(space.cgeom.verts.size()));
-        space.texture.unbind();
+        // The renderers below draw themselves, the queue only orders them.
+        // Their packets all point at this instead of capturing locals.
+        SelfDrawn drawn{&orbits, asteroids.get(), &skybox, stars.get(),
+                        a4->camera.getView(), a4->getProjection(), size, eye, bodies.front()->position};
+
+        // orbit paths, all in one instanced draw, sorted after the bodies so
+        // those keep the program bound above
+        RenderQueue::Packet orbitPacket;
+        orbitPacket.key = RenderQueue::makeKey(RenderQueue::Pass::Opaque, ~GLuint(0), 0, 0, 0.0f);
+        orbitPacket.name = "orbits";
+        orbitPacket.custom = [](void *context)
+        {
+            const SelfDrawn &d = *static_cast<const SelfDrawn *>(context);
+            d.orbits->draw(d.V, d.P, d.viewport, d.eye);
+        };
+        orbitPacket.context = &drawn;
+        queue.submit(std::move(orbitPacket));
 
-        // earth drawing
-        earth.transformVerts();
-        earth.ggeom.bind();
+        if (asteroids)
+        {
+            RenderQueue::Packet asteroidPacket;
+            asteroidPacket.key = RenderQueue::makeKey(RenderQueue::Pass::Opaque, ~GLuint(0), 0, 0, 0.0f);
+            asteroidPacket.name = "asteroids";
+            asteroidPacket.custom = [](void *context)
+            {
+                const SelfDrawn &d = *static_cast<const SelfDrawn *>(context);
+                d.asteroids->draw(d.V, d.P, d.viewport, d.eye, d.sun);
+            };
+            asteroidPacket.context = &drawn;
+            queue.submit(std::move(asteroidPacket));
+        }
 
-        earth.texture.bind();
-        glDrawArrays(GL_TRIANGLES, 0, GLsizei(earth.cgeom.verts.size()));
-        earth.texture.unbind();
+        // background after the opaque pass, so only uncovered pixels are shaded
+        RenderQueue::Packet skyboxPacket;
+        skyboxPacket.key = RenderQueue::makeKey(RenderQueue::Pass::Background, 0, 0, 0, 0.0f);
+        skyboxPacket.name = "skybox";
+        skyboxPacket.custom = [](void *context)
+        {
+            const SelfDrawn &d = *static_cast<const SelfDrawn *>(context);
+            d.skybox->draw(d.V, d.P);
+        };
+        skyboxPacket.context = &drawn;
+        queue.submit(std::move(skyboxPacket));
+
+        // stars add light over the skybox
+        if (stars)
+        {
+            RenderQueue::Packet starPacket;
+            starPacket.key = RenderQueue::makeKey(RenderQueue::Pass::Transparent, 0, 0, 0, 0.0f);
+            starPacket.name = "stars";
+            starPacket.custom = [](void *context)
+            {
+                const SelfDrawn &d = *static_cast<const SelfDrawn *>(context);
+                d.stars->draw(d.V, d.P);
+            };
+            starPacket.context = &drawn;
+            queue.submit(std::move(starPacket));
+        }
 
-        // sun drawing
-        sun.transformSun();
-        sun.ggeom.bind();
+        queue.execute(&profiler);
 
-        sun.texture.bind();
-        glDrawArrays(GL_TRIANGLES, 0, GLsizei(sun.cgeom.verts.size()));
-        sun.texture.unbind();
+        {
+            PROFILE_ZONE("sim");
 
-        // moon drawing
-        moon.transformVerts();
-        moon.ggeom.bind();
+            // About as far along as continueOrbit moves the others per frame;
+            // N jumps to the next eclipse within ten years instead
+            bool jumped = false;
+            if ((ephemeris || spk) && solar_system.next_eclipse)
+            {
+                StateQuery query(ephemeris.get(), spk.get());
+                std::vector<EventSearch::Event> eclipses = EventSearch(query).eclipses(julianDate + 0.01, julianDate + 3652.5);
+                if (eclipses.empty())
+                {
+                    Log::info("ECLIPSE none within ten years of JD {:.2f}", julianDate);
+                }
+                else
+                {
+                    const EventSearch::Event &eclipse = eclipses.front();
+                    julianDate = eclipse.julianDate;
+                    jumped = true;
+                    Log::info("ECLIPSE {} {} at JD {:.5f}", EventSearch::eclipseName(eclipse.eclipse), EventSearch::kindName(eclipse.kind), julianDate);
+                }
+            }
+            solar_system.next_eclipse = false;
+            if ((ephemeris || spk) && solar_system.orbital_rotation)
+            {
+                julianDate += 0.3 * solar_system.speed;
+            }
+            if (ephemeris && (jumped || solar_system.orbital_rotation))
+            {
+                julianDate = std::min(julianDate, ephemeris->endJD());
+                ephemeris->allHeliocentricEcliptic(julianDate, heliocentric);
+            }
+            if (trajectories)
+            {
+                // About ten seconds of frames ahead at 60 Hz
+                double ahead = solar_system.orbital_rotation ? 0.3 * std::abs(solar_system.speed) * 600.0 : 0.0;
+                trajectories->setPlayhead(julianDate, std::max(ahead, 1.0));
+            }
+
+            for (const auto &body : bodies)
+            {
+                if (solar_system.earth_rotation && body->spin != 0.0f)
+                {
+                    body->continueRotation(solar_system.speed, body->spin);
+                }
+                if (body->follows_spk)
+                {
+                    followSpk(*body, *trajectories, julianDate);
+                }
+                else if (body->ephemeris >= 0)
+                {
+                    followEphemeris(*body, heliocentric);
+                }
+                else if (body->elements[0] > 0.0)
+                {
+                    if (solar_system.orbital_rotation)
+                    {
+                        body->continueElements(solar_system.speed);
+                    }
+                    body->followElements();
+                    if (body->orbit_path >= 0)
+                    {
+                        orbits.setCenter(size_t(body->orbit_path), body->parent ? body->parent->position : glm::dvec3(0.0));
+                    }
+                }
+                else if (solar_system.orbital_rotation && body->revolves_about)
+                {
+                    body->continueOrbit(body->revolves_about->position, solar_system.speed);
+                }
+            }
+        }
 
-        moon.texture.bind();
-        glDrawArrays(GL_TRIANGLES, 0, GLsizei(moon.cgeom.verts.size()));
-        moon.texture.unbind();
+        GLState::disable(GL_FRAMEBUFFER_SRGB); // disable sRGB for things like imgui
 
-        if (solar_system.earth_rotation)
+        // the scene only, before the UI is drawn over it
+        if (capture)
         {
-            earth.continueRotation(solar_system.speed, 1);
-            moon.continueRotation(solar_system.speed, 0.5);
+            GpuProfiler::Scope pass(profiler, "capture");
+            capture->capture(framebuffer);
         }
 
-        if (solar_system.orbital_rotation)
+        framebuffer.unbind();
+
+        // Headless frames stay in the framebuffer and have no UI. In a window
+        // the offscreen colour is already sRGB encoded, so copy it as is
+        if (window)
         {
-            earth.continueOrbit(sun.position, solar_system.speed);
-            moon.continueOrbit(sun.position,solar_system.speed);
+            GpuProfiler::Scope pass(profiler, "blit");
+            framebuffer.blitToDefault(size.x, size.y);
         }
 
-        glDisable(GL_FRAMEBUFFER_SRGB); // disable sRGB for things like imgui
+        if (window)
+        {
+            PROFILE_ZONE("ui");
+
+            // Starting the new ImGui frame
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
+            // Putting the text-containing window in the top-left of the screen.
+            ImGui::SetNextWindowPos(ImVec2(5, 5));
+
+            // Setting flags
+            ImGuiWindowFlags textWindowFlags =
+                ImGuiWindowFlags_NoMove |           // text "window" should not move
+                ImGuiWindowFlags_NoResize |         // should not resize
+                ImGuiWindowFlags_NoCollapse |       // should not collapse
+                ImGuiWindowFlags_NoSavedSettings |  // don't want saved settings mucking things up
+                ImGuiWindowFlags_AlwaysAutoResize | // window should auto-resize to fit the text
+                ImGuiWindowFlags_NoBackground |     // window should be transparent; only the text should be visible
+                ImGuiWindowFlags_NoDecoration |     // no decoration; only the text should be visible
+                ImGuiWindowFlags_NoTitleBar;        // no title; only the text should be visible
+
+            // Begin a new window with these flags. (bool *)0 is the "default" value for its argument.
+            ImGui::Begin("I/O Info", (bool *)0, textWindowFlags);
+
+            // Scale up text a little, and set its value
+            ImGui::SetWindowFontScale(1.5f);
+            ImGui::Text("Press Q to Pause Earth's Rotation");
+            ImGui::Text("Press E to Pause Orbital Rotation");
+            ImGui::Text("Press 1/2/3 to Focus the Sun/Earth/Moon");
+            ImGui::Text("Press G to Toggle GPU Timings");
+            ImGui::Text("Press H to Toggle the Performance HUD");
+#if ORRERY_PROFILING
+            ImGui::Text("Press T to Write a CPU Trace");
+#endif
+
+            if (solar_system.orbital_rotation)
+            {
+                ImGui::Text("Orbital Rotation: Ongoing");
+            }
+            else
+            {
+                ImGui::Text("Orbital Rotation: Paused");
+            }
 
-        // Starting the new ImGui frame
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
-        // Putting the text-containing window in the top-left of the screen.
-        ImGui::SetNextWindowPos(ImVec2(5, 5));
+            if (solar_system.earth_rotation)
+            {
+                ImGui::Text("Earth's Rotation: Ongoing");
+            }
+            else
+            {
+                ImGui::Text("Earth's Rotation: Paused");
+            }
 
-        // Setting flags
-        ImGuiWindowFlags textWindowFlags =
-            ImGuiWindowFlags_NoMove |           // text "window" should not move
-            ImGuiWindowFlags_NoResize |         // should not resize
-            ImGuiWindowFlags_NoCollapse |       // should not collapse
-            ImGuiWindowFlags_NoSavedSettings |  // don't want saved settings mucking things up
-            ImGuiWindowFlags_AlwaysAutoResize | // window should auto-resize to fit the text
-            ImGuiWindowFlags_NoBackground |     // window should be transparent; only the text should be visible
-            ImGuiWindowFlags_NoDecoration |     // no decoration; only the text should be visible
-            ImGuiWindowFlags_NoTitleBar;        // no title; only the text should be visible
+            // End the window.
+            ImGui::End();
 
-        // Begin a new window with these flags. (bool *)0 is the "default" value for its argument.
-        ImGui::Begin("I/O Info", (bool *)0, textWindowFlags);
+            if (solar_system.gpu_profiler)
+            {
+                profiler.drawImGui(&solar_system.gpu_profiler);
+            }
 
-        // Scale up text a little, and set its value
-        ImGui::SetWindowFontScale(1.5f);
-        ImGui::Text("Press Q to Pause Earth's Rotation");
-        ImGui::Text("Press E to Pause Orbital Rotation");
+            if (solar_system.perf_hud)
+            {
+                hud.draw(&solar_system.perf_hud);
+            }
 
-        if (solar_system.orbital_rotation)
-        {
-            ImGui::Text("Orbital Rotation: Ongoing");
+            ImGui::Render(); // Render the ImGui window
+            {
+                GpuProfiler::Scope pass(profiler, "imgui");
+                ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); // Some middleware thing
+            }
         }
-        else
+
+        if (solar_system.write_trace)
         {
-            ImGui::Text("Orbital Rotation: Paused");
+#if ORRERY_PROFILING
+            Profiler::writeTrace("orrery_trace.json");
+#else
+            Log::info("PROFILER disabled in this build (ORRERY_PROFILING=0), no trace written");
+#endif
+            solar_system.write_trace = false;
         }
 
-        if (solar_system.earth_rotation)
+        profiler.endFrame();
+        stream.endFrame();
+        if (window)
         {
-            ImGui::Text("Earth's Rotation: Ongoing");
+            window->swapBuffers();
         }
         else
         {
-            ImGui::Text("Earth's Rotation: Paused");
+            glFlush();
+        }
+
+        if (benchmark)
+        {
+            benchmark->addFrame(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - now).count(), RenderStats::current);
+            benchmark->addGpuFrame(profiler.getLatest());
         }
+        frame++;
+    }
 
-        // End the window.
-        ImGui::End();
+    if (capture)
+    {
+        capture->finish();
+    }
+    GLDebug::logSummary();
+    if (trajectories)
+    {
+        trajectories->logSummary();
+    }
 
-        ImGui::Render();                                        // Render the ImGui window
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); // Some middleware thing
+    if (benchmark)
+    {
+        std::string reportPath;
+        cmdl("benchmark-out", "benchmark.json") >> reportPath;
+        benchmark->writeReport(reportPath, {
+            {"mode", headless ? "headless" : "windowed"},
+            {"context", contextModeName(contextMode)},
+            {"renderer", reinterpret_cast<const char *>(glGetString(GL_RENDERER))},
+            {"version", reinterpret_cast<const char *>(glGetString(GL_VERSION))},
+            {"resolution", fmt::format("{}x{}", drawableSize().x, drawableSize().y)},
+            {"profiling", ORRERY_PROFILING ? "on" : "off"},
+        });
+    }
 
-        window.swapBuffers();
+    if (headless)
+    {
+        Log::info("HEADLESS rendered {} frames, p50 {:.2f} ms, p95 {:.2f} ms, p99 {:.2f} ms",
+                  frame, hud.percentile(0.5f), hud.percentile(0.95f), hud.percentile(0.99f));
+        return 0;
     }
 
     // ImGui cleanup
@@ -0,0 +1,16 @@
+#version 430 core
+
+in vec3 fragPos;
+in vec3 fragColor;
+in vec3 n;
+
+uniform vec3 light;
+
+out vec4 color;
+
+void main() {
+    vec3 lightDir = normalize(light - fragPos);
+    float diff = max(dot(normalize(n), lightDir), 0.0);
+
+    color = vec4((0.12 + diff) * fragColor, 1.0);
+}
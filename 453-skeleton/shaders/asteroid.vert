@@ -0,0 +1,28 @@
+#version 430 core
+layout (location = 0) in vec3 pos;          // unit sphere, so also the normal
+layout (location = 1) in uint instance;     // from the culled list
+
+struct Instance {
+    vec4 centerRadius;
+    vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+
+uniform mat4 V;
+uniform mat4 P;
+uniform vec3 eye;
+
+out vec3 fragPos;
+out vec3 fragColor;
+out vec3 n;
+
+void main() {
+    Instance asteroid = instances[instance];
+    vec3 center = asteroid.centerRadius.xyz - eye;
+
+    fragPos = center + pos * asteroid.centerRadius.w;
+    fragColor = asteroid.color.rgb;
+    n = pos;
+    gl_Position = P * V * vec4(fragPos, 1.0);
+}
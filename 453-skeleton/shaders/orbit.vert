@@ -0,0 +1,53 @@
+#version 330 core
+layout (location = 0) in vec4 centerAndAxis;  // xyz = center relative to the eye, w = semi-major axis
+layout (location = 1) in vec4 elements;       // eccentricity, inclination, ascending node, argument of periapsis
+layout (location = 2) in vec3 color;
+
+uniform mat4 V;
+uniform mat4 P;
+uniform vec2 viewport;
+uniform int maxSegments;
+uniform float pixelsPerSegment;
+
+out vec3 fragColor;
+
+const float PI = 3.14159265359;
+
+// Rotation about the z axis followed by the x axis, as used by the
+// classical perifocal -> reference frame transformation.
+vec3 rotateZ(vec3 p, float a) {
+    return vec3(p.x * cos(a) - p.y * sin(a), p.x * sin(a) + p.y * cos(a), p.z);
+}
+
+vec3 rotateX(vec3 p, float a) {
+    return vec3(p.x, p.y * cos(a) - p.z * sin(a), p.y * sin(a) + p.z * cos(a));
+}
+
+void main() {
+    // Centres arrive already rebased on the eye, subtracted in double on
+    // the CPU, so nothing large is ever differenced in float here
+    vec3 center = centerAndAxis.xyz;
+    float a = centerAndAxis.w;
+    float e = elements.x;
+
+    // Pick a segment count from how large the orbit appears on screen
+    float apoapsis = a * (1.0 + e);
+    float dist = length((V * vec4(center, 1.0)).xyz);
+    float nearest = max(dist - apoapsis, 0.001 * apoapsis);
+    float radiusPixels = apoapsis / nearest * P[1][1] * 0.5 * viewport.y;
+    int segments = clamp(int(2.0 * PI * radiusPixels / pixelsPerSegment), 8, maxSegments);
+
+    // Surplus vertices collapse onto the closing point, producing
+    // zero-length segments that rasterize nothing
+    int i = min(gl_VertexID, segments);
+    float E = 2.0 * PI * float(i) / float(segments);
+
+    // Position in the orbital (perifocal) plane, periapsis along +x
+    vec3 p = vec3(a * (cos(E) - e), a * sqrt(1.0 - e * e) * sin(E), 0.0);
+    p = rotateZ(p, elements.w);
+    p = rotateX(p, elements.y);
+    p = rotateZ(p, elements.z);
+
+    fragColor = color;
+    gl_Position = P * V * vec4(center + p, 1.0);
+}
@@ -0,0 +1,12 @@
+#version 330 core
+
+in vec3 dir;
+
+uniform samplerCube sampler;
+uniform float brightness;
+
+out vec4 color;
+
+void main() {
+    color = vec4(brightness * texture(sampler, dir).rgb, 1.0);
+}
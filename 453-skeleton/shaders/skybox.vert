@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec3 pos;
+
+uniform mat4 V;
+uniform mat4 P;
+uniform float farPlane;
+
+out vec3 dir;
+
+void main() {
+    dir = pos;
+    vec4 clip = P * V * vec4(pos, 1.0);
+
+    // Puts every vertex on the far plane after the perspective divide
+    gl_Position = vec4(clip.xy, farPlane * clip.w, clip.w);
+}
@@ -0,0 +1,12 @@
+#version 330 core
+
+in vec3 fragColor;
+
+out vec4 color;
+
+void main() {
+    // Round, soft-edged sprite
+    float r = length(gl_PointCoord - vec2(0.5));
+    float falloff = 1.0 - smoothstep(0.25, 0.5, r);
+    color = vec4(fragColor * falloff, 1.0);
+}
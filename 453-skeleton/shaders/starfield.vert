@@ -0,0 +1,29 @@
+#version 330 core
+layout (location = 0) in vec3 direction;
+layout (location = 1) in float magnitude;
+layout (location = 2) in vec3 color;
+
+uniform mat4 V;
+uniform mat4 P;
+uniform float farPlane;
+uniform float magnitudeLimit;
+uniform float pointScale;
+
+out vec3 fragColor;
+
+void main() {
+    // Each magnitude is a factor of 100^(1/5) in flux; brightness is 1 at the limit
+    float flux = pow(10.0, -0.4 * (magnitude - magnitudeLimit));
+
+    // Bright stars grow, faint ones fade out instead of shrinking below a pixel
+    gl_PointSize = clamp(pointScale * sqrt(flux), 1.0, 8.0 * pointScale);
+    fragColor = color * clamp(flux, 0.0, 1.0);
+
+    vec4 clip = P * V * vec4(direction, 1.0);
+    gl_Position = vec4(clip.xy, farPlane * clip.w, clip.w);
+
+    // Cull stars beyond the limit by moving them outside the clip volume
+    if (magnitude > magnitudeLimit) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+    }
+}
@@ -4,6 +4,7 @@ in vec3 fragPos;
 in vec3 fragColor;
 in vec3 n;
 in vec2 tc;
+in float ambientLight;
 
 uniform sampler2D sampler;
 uniform vec3 light;
@@ -16,7 +17,7 @@ void main() {
     vec3 normal = normalize(n);
     float diff = max(dot(normal, lightDir), 0.0);
 
-    vec3 ambient = 0.12 * tex;
+    vec3 ambient = ambientLight * tex;
     vec3 diffuse = diff * tex;
 
     color = vec4((ambient + diffuse), 1.0);
@@ -4,7 +4,14 @@ layout (location = 1) in vec3 color;
 layout (location = 2) in vec3 normal;
 layout (location = 3) in vec2 texCoord;
 
-uniform mat4 M;
+// Streamed per object. M is relative to the eye, N is its normal matrix,
+// material.x is the ambient light the body receives.
+layout (std140) uniform Object {
+    mat4 M;
+    mat4 N;
+    vec4 material;
+};
+
 uniform mat4 V; 
 uniform mat4 P; 
 
@@ -12,11 +19,14 @@ out vec3 fragPos;
 out vec3 fragColor;
 out vec3 n;
 out vec2 tc;
+out float ambientLight;
 
 void main() {
     tc = texCoord;
-	fragPos = pos;
+    vec4 worldPos = M * vec4(pos, 1.0);
+	fragPos = worldPos.xyz;
 	fragColor = color;
-	n = mat3(transpose(inverse(M))) * normal;
-	gl_Position = P * V * M * vec4(pos, 1.0);
+	n = mat3(N) * normal;
+	ambientLight = material.x;
+	gl_Position = P * V * worldPos;
 }
@@ -0,0 +1,219 @@
+//------------------------------------------------------------------------------
+// Converts a JPL DE ephemeris from its ASCII distribution into the binary
+// format read by Ephemeris.
+//
+// Usage: ephconv <header.440> <ascp01550.440> [more data files...] <output.eph>
+//
+// The header file supplies the time span (group 1030), the constants AU and
+// EMRAT (groups 1040/1041) and the coefficient pointer table (group 1050).
+// The data files are read in the order given; records must follow on from
+// each other, and the record repeated where consecutive files overlap is
+// dropped. Only the eleven position series are kept.
+//------------------------------------------------------------------------------
+
+#include "EphemerisFile.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+	// Fortran writes exponents with a D
+	bool toDouble(std::string token, double& value) {
+		std::replace(token.begin(), token.end(), 'D', 'E');
+		std::replace(token.begin(), token.end(), 'd', 'e');
+		char* end = nullptr;
+		value = std::strtod(token.c_str(), &end);
+		return end != token.c_str() && *end == '\0';
+	}
+
+	// Every token of the header, split into its groups by "GROUP nnnn"
+	bool readHeader(const std::string& path, std::map<int, std::vector<std::string>>& groups, long& coefficientCount) {
+		std::ifstream input(path);
+		if (!input) {
+			return false;
+		}
+		std::string token;
+		int group = 0;
+		coefficientCount = 0;
+		while (input >> token) {
+			if (token == "GROUP" && input >> group) {
+				continue;
+			}
+			if (token == "NCOEFF=") {
+				input >> coefficientCount;
+				continue;
+			}
+			groups[group].push_back(token);
+		}
+		return true;
+	}
+}
+
+
+int main(int argc, char** argv) {
+	if (argc < 4) {
+		Log::error("usage: ephconv <header.4xx> <data files...> <output.eph>");
+		return 1;
+	}
+	std::string headerPath = argv[1];
+	std::string outputPath = argv[argc - 1];
+
+	std::map<int, std::vector<std::string>> groups;
+	long sourceCoefficients = 0;
+	if (!readHeader(headerPath, groups, sourceCoefficients)) {
+		Log::error("EPHCONV unable to open {}", headerPath);
+		return 1;
+	}
+
+	// Group 1030: start, end, days per record
+	double span[3];
+	const std::vector<std::string>& times = groups[1030];
+	if (times.size() < 3 || !toDouble(times[0], span[0]) || !toDouble(times[1], span[1]) || !toDouble(times[2], span[2]) || span[2] <= 0.0) {
+		Log::error("EPHCONV {} has no time span (group 1030)", headerPath);
+		return 1;
+	}
+
+	// Groups 1040/1041: a count, then that many names and values
+	std::map<std::string, double> constants;
+	const std::vector<std::string>& names = groups[1040];
+	const std::vector<std::string>& values = groups[1041];
+	for (size_t i = 1; i < names.size() && i < values.size(); i++) {
+		double value;
+		if (toDouble(values[i], value)) {
+			constants[names[i]] = value;
+		}
+	}
+	if (!constants.count("AU") || !constants.count("EMRAT")) {
+		Log::error("EPHCONV {} is missing the AU or EMRAT constant", headerPath);
+		return 1;
+	}
+
+	// Group 1050: three rows (offset, coefficients, subintervals), one column
+	// per series; newer files have more columns than older ones
+	const std::vector<std::string>& pointers = groups[1050];
+	size_t columns = pointers.size() / 3;
+	if (pointers.size() % 3 != 0 || columns < EphemerisFile::seriesCount) {
+		Log::error("EPHCONV {} has no usable pointer table (group 1050)", headerPath);
+		return 1;
+	}
+	long sourceOffset[EphemerisFile::seriesCount];
+	EphemerisFile::Series series[EphemerisFile::seriesCount] = {};
+	uint32_t recordDoubles = 0;
+	for (uint32_t s = 0; s < EphemerisFile::seriesCount; s++) {
+		sourceOffset[s] = std::atol(pointers[s].c_str()) - 1;
+		series[s].offset = recordDoubles;
+		series[s].coefficients = uint32_t(std::atol(pointers[columns + s].c_str()));
+		series[s].subintervals = uint32_t(std::atol(pointers[2 * columns + s].c_str()));
+		long end = sourceOffset[s] + 3L * series[s].coefficients * series[s].subintervals;
+		if (sourceOffset[s] < 2 || series[s].coefficients == 0 || series[s].subintervals == 0 || (sourceCoefficients > 0 && end > sourceCoefficients)) {
+			Log::error("EPHCONV {} has an invalid pointer for series {}", headerPath, s);
+			return 1;
+		}
+		sourceCoefficients = std::max(sourceCoefficients, end);
+		recordDoubles += 3 * series[s].coefficients * series[s].subintervals;
+	}
+
+	// Records: index, coefficient count, then the coefficients, the first
+	// two being the Julian dates the record spans
+	std::vector<double> records;
+	std::vector<double> source(static_cast<size_t>(sourceCoefficients));
+	double startJD = 0.0;
+	double endJD = 0.0;
+	uint32_t recordCount = 0;
+	for (int file = 2; file < argc - 1; file++) {
+		std::ifstream input(argv[file]);
+		if (!input) {
+			Log::error("EPHCONV unable to open {}", argv[file]);
+			return 1;
+		}
+
+		long index, count;
+		std::string token;
+		while (input >> index >> count) {
+			// Three to a line, the last line padded out with zeros
+			long padded = (count + 2) / 3 * 3;
+			if (count < sourceCoefficients) {
+				Log::error("EPHCONV record {} of {} has {} coefficients, expected {}", index, argv[file], count, sourceCoefficients);
+				return 1;
+			}
+			for (long i = 0; i < padded; i++) {
+				double value = 0.0;
+				if (!(input >> token) || !toDouble(token, value)) {
+					Log::error("EPHCONV record {} of {} is truncated", index, argv[file]);
+					return 1;
+				}
+				if (i < sourceCoefficients) {
+					source[size_t(i)] = value;
+				}
+			}
+
+			if (recordCount > 0 && source[0] < endJD - 1e-6) {
+				continue;	// repeated where files overlap
+			}
+			if (recordCount > 0 && std::abs(source[0] - endJD) > 1e-6) {
+				Log::error("EPHCONV gap in {} between JD {} and {}", argv[file], endJD, source[0]);
+				return 1;
+			}
+			if (recordCount == 0) {
+				startJD = source[0];
+			}
+			endJD = source[1];
+
+			// JPL stores all x coefficients of a span, then y, then z
+			for (uint32_t s = 0; s < EphemerisFile::seriesCount; s++) {
+				uint32_t n = series[s].coefficients;
+				for (uint32_t sub = 0; sub < series[s].subintervals; sub++) {
+					const double* span = source.data() + sourceOffset[s] + 3 * n * sub;
+					for (uint32_t k = 0; k < n; k++) {
+						records.push_back(span[k]);
+						records.push_back(span[n + k]);
+						records.push_back(span[2 * n + k]);
+					}
+				}
+			}
+			recordCount++;
+		}
+	}
+	if (recordCount == 0) {
+		Log::error("EPHCONV no records read");
+		return 1;
+	}
+
+	EphemerisFile::Header header{};
+	std::copy(std::begin(EphemerisFile::magic), std::end(EphemerisFile::magic), header.magic);
+	header.version = EphemerisFile::version;
+	header.seriesCount = EphemerisFile::seriesCount;
+	header.recordCount = recordCount;
+	header.recordDoubles = recordDoubles;
+	header.denumber = constants.count("DENUM") ? uint32_t(constants["DENUM"]) : 0;
+	header.startJD = startJD;
+	header.intervalDays = span[2];
+	header.au = constants["AU"];
+	header.earthMoonRatio = constants["EMRAT"];
+
+	std::filesystem::path parent = std::filesystem::path(outputPath).parent_path();
+	if (!parent.empty()) {
+		std::filesystem::create_directories(parent);
+	}
+
+	std::ofstream output(outputPath, std::ios::binary);
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	output.write(reinterpret_cast<const char*>(series), sizeof(series));
+	output.write(reinterpret_cast<const char*>(records.data()), std::streamsize(sizeof(double) * records.size()));
+	if (!output) {
+		Log::error("EPHCONV unable to write {}", outputPath);
+		return 1;
+	}
+
+	Log::info("EPHCONV wrote DE{} records for JD {} to {} ({} days each) to {}", header.denumber, startJD, endJD, span[2], outputPath);
+	return 0;
+}
@@ -0,0 +1,160 @@
+//------------------------------------------------------------------------------
+// Lists eclipses, conjunctions or close approaches over a span of dates.
+//
+// Usage: ephevents eclipses --start <JD> --end <JD>
+//        ephevents conjunctions --bodies venus,jupiter [--observer earth]
+//                  [--oppositions] --start <JD> --end <JD>
+//        ephevents approaches --bodies 399,2000433 --within <km>
+//                  --start <JD> --end <JD>
+//        with [--ephemeris de440.eph] [--spk a.bsp,b.bsp] [--step 1]
+//             [--threads 0] [--csv events.csv]
+//
+// Bodies are NAIF ids or the names Ephemeris knows; states come from the SPK
+// kernels where they cover a body and the DE ephemeris otherwise. Events are
+// logged in date order (TDB) and, with --csv, written as
+// "jd,kind,body,body,eclipse,value" rows (see EventSearch::Event for value).
+//------------------------------------------------------------------------------
+
+#include "EventSearch.h"
+#include "Frames.h"
+#include "Log.h"
+
+#include <argh.h>
+#include <fmt/format.h>
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+	std::string dateString(double julianDate) {
+		int year, month, day;
+		double hours;
+		Frames::calendarDate(julianDate, year, month, day, hours);
+		int minutes = int(hours * 60.0);
+		return fmt::format("{}-{:02}-{:02} {:02}:{:02}", year, month, day, minutes / 60, minutes % 60);
+	}
+
+	bool readBodies(const std::string& list, std::vector<int>& bodies) {
+		std::stringstream tokens(list);
+		std::string token;
+		while (std::getline(tokens, token, ',')) {
+			int id;
+			if (!StateQuery::bodyFromName(token, id)) {
+				Log::error("EPHEVENTS unknown body {}", token);
+				return false;
+			}
+			bodies.push_back(id);
+		}
+		return true;
+	}
+}
+
+
+int main(int argc, char** argv) {
+	argh::parser cmdl(argc, argv, argh::parser::PREFER_PARAM_FOR_UNREG_OPTION);
+
+	// Defaults given to argh are printed to six digits, so none for dates
+	std::string search;
+	double start, end;
+	if (!(cmdl(1) >> search) || !(cmdl("start") >> start) || !(cmdl("end") >> end)) {
+		Log::error("usage: ephevents eclipses|conjunctions|approaches --start <JD> --end <JD> [--bodies a,b] [--observer earth] [--oppositions] [--within <km>] [--ephemeris <file.eph>] [--spk <a.bsp,b.bsp>] [--step 1] [--threads 0] [--csv <file>]");
+		return 1;
+	}
+
+	std::unique_ptr<Ephemeris> ephemeris;
+	std::unique_ptr<SpkEphemeris> spk;
+	try {
+		std::string ephemerisPath;
+		if (cmdl("ephemeris") >> ephemerisPath) {
+			ephemeris = std::make_unique<Ephemeris>(ephemerisPath);
+		}
+		std::string spkPaths;
+		if (cmdl("spk") >> spkPaths) {
+			spk = std::make_unique<SpkEphemeris>();
+			std::stringstream kernels(spkPaths);
+			std::string kernel;
+			while (std::getline(kernels, kernel, ',')) {
+				spk->load(kernel);
+			}
+		}
+	}
+	catch (std::runtime_error&) {
+		return 1;	// already logged
+	}
+	if (!ephemeris && !spk) {
+		Log::error("EPHEVENTS needs an --ephemeris, --spk kernels, or both");
+		return 1;
+	}
+
+	double step = 1.0;
+	cmdl("step", 1.0) >> step;
+	unsigned threads = 0;
+	cmdl("threads", 0) >> threads;
+	StateQuery query(ephemeris.get(), spk.get());
+	EventSearch events(query, threads);
+
+	std::vector<int> bodies;
+	std::string bodyList;
+	if (cmdl("bodies") >> bodyList && !readBodies(bodyList, bodies)) {
+		return 1;
+	}
+
+	auto started = std::chrono::steady_clock::now();
+	std::vector<EventSearch::Event> found;
+	if (search == "eclipses") {
+		found = events.eclipses(start, end);
+	}
+	else if (search == "conjunctions" && bodies.size() == 2) {
+		std::string observerName = "earth";
+		cmdl("observer") >> observerName;
+		int observer;
+		if (!StateQuery::bodyFromName(observerName, observer)) {
+			Log::error("EPHEVENTS unknown observer {}", observerName);
+			return 1;
+		}
+		found = events.conjunctions(bodies[0], bodies[1], observer, start, end, cmdl["oppositions"], step);
+	}
+	else if (search == "approaches" && bodies.size() == 2) {
+		double within;
+		if (!(cmdl("within") >> within)) {
+			Log::error("EPHEVENTS approaches needs --within <km>");
+			return 1;
+		}
+		found = events.closeApproaches(bodies[0], bodies[1], within, start, end, step);
+	}
+	else {
+		Log::error("EPHEVENTS unknown search {}, or it needs --bodies a,b", search);
+		return 1;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	for (const EventSearch::Event& event : found) {
+		std::string kind = EventSearch::kindName(event.kind);
+		if (event.eclipse != EventSearch::Eclipse::None) {
+			kind = fmt::format("{} {}", EventSearch::eclipseName(event.eclipse), kind);
+		}
+		Log::info("{} JD {:.5f} {} {} {} {:.4f}", dateString(event.julianDate), event.julianDate, kind, event.bodies[0], event.bodies[1], event.value);
+	}
+	Log::info("EPHEVENTS {} events between JD {} and {} in {:.3f} s", found.size(), start, end, seconds);
+
+	std::string csvPath;
+	if (cmdl("csv") >> csvPath) {
+		std::ofstream output(csvPath);
+		output << "jd,kind,body,body,eclipse,value\n";
+		for (const EventSearch::Event& event : found) {
+			output << fmt::format("{},{},{},{},{},{}\n", event.julianDate, EventSearch::kindName(event.kind),
+				event.bodies[0], event.bodies[1], EventSearch::eclipseName(event.eclipse), event.value);
+		}
+		if (!output) {
+			Log::error("EPHEVENTS unable to write {}", csvPath);
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,201 @@
+//------------------------------------------------------------------------------
+// Writes the states of many bodies over a grid of epochs, without a window.
+//
+// Usage: ephquery <output> --bodies 399,301,mars [--center 0]
+//                 (--start <JD> --end <JD> --step <days> | --epochs <file>)
+//                 [--ephemeris de440.eph] [--spk a.bsp,b.bsp]
+//                 [--format csv|binary] [--threads 0]
+//
+// Bodies are NAIF ids or the names Ephemeris knows; the centre defaults to
+// the solar system barycentre. Epochs are TDB Julian dates, either a grid
+// from start to end inclusive or one per line of a file. States come from
+// the SPK kernels where they cover a body and the DE ephemeris otherwise (see
+// StateQuery), in kilometres and kilometres per second on ICRF axes; those
+// neither covers are NaN.
+//
+// CSV output has a header row, then "body,jd,x,y,z,vx,vy,vz" for every body
+// in turn, epochs in order. Binary output is little-endian:
+//	char[4] "OSTV", uint32 version (1), uint32 body count, int32 centre,
+//	uint64 epoch count, int32 bodies[], double epochs[], then for every body
+//	in turn and every epoch six doubles: x, y, z, vx, vy, vz.
+//------------------------------------------------------------------------------
+
+#include "Log.h"
+#include "StateQuery.h"
+
+#include <argh.h>
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+	struct Header {
+		char magic[4] = { 'O', 'S', 'T', 'V' };
+		uint32_t version = 1;
+		uint32_t bodyCount;
+		int32_t center;
+		uint64_t epochCount;
+	};
+	static_assert(sizeof(Header) == 24, "the state file header is read byte for byte");
+
+	bool readEpochs(const std::string& path, std::vector<double>& epochs) {
+		std::ifstream input(path);
+		std::string line;
+		while (std::getline(input, line)) {
+			if (line.empty() || line[0] == '#') {
+				continue;
+			}
+			char* end = nullptr;
+			double jd = std::strtod(line.c_str(), &end);
+			if (end == line.c_str()) {
+				Log::error("EPHQUERY {} has a line that isn't a Julian date: {}", path, line);
+				return false;
+			}
+			epochs.push_back(jd);
+		}
+		return bool(input.eof());
+	}
+}
+
+
+int main(int argc, char** argv) {
+	argh::parser cmdl(argc, argv, argh::parser::PREFER_PARAM_FOR_UNREG_OPTION);
+
+	std::string outputPath;
+	std::string bodyList;
+	if (!(cmdl(1) >> outputPath) || !(cmdl("bodies") >> bodyList)) {
+		Log::error("usage: ephquery <output> --bodies 399,301,mars [--center 0] (--start <JD> --end <JD> --step <days> | --epochs <file>) [--ephemeris <file.eph>] [--spk <a.bsp,b.bsp>] [--format csv|binary] [--threads 0]");
+		return 1;
+	}
+
+	std::vector<int> bodies;
+	std::stringstream bodyTokens(bodyList);
+	std::string token;
+	while (std::getline(bodyTokens, token, ',')) {
+		int id;
+		if (!StateQuery::bodyFromName(token, id)) {
+			Log::error("EPHQUERY unknown body {}", token);
+			return 1;
+		}
+		bodies.push_back(id);
+	}
+	std::string centerName = "0";
+	cmdl("center") >> centerName;
+	int center;
+	if (bodies.empty() || !StateQuery::bodyFromName(centerName, center)) {
+		Log::error("EPHQUERY no bodies, or an unknown centre {}", centerName);
+		return 1;
+	}
+
+	// Defaults given to argh are printed to six digits, so none for dates
+	std::vector<double> epochs;
+	std::string epochPath;
+	double start, end, step;
+	if (cmdl("epochs") >> epochPath) {
+		if (!readEpochs(epochPath, epochs)) {
+			Log::error("EPHQUERY unable to read epochs from {}", epochPath);
+			return 1;
+		}
+	}
+	else if ((cmdl("start") >> start) && (cmdl("end") >> end) && (cmdl("step") >> step) && step > 0.0 && end >= start) {
+		// Multiplied rather than summed, so long grids don't drift
+		size_t count = size_t((end - start) / step + 1e-9) + 1;
+		epochs.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			epochs[i] = start + step * double(i);
+		}
+	}
+	if (epochs.empty()) {
+		Log::error("EPHQUERY needs --epochs <file>, or --start, --end and a positive --step");
+		return 1;
+	}
+
+	std::unique_ptr<Ephemeris> ephemeris;
+	std::unique_ptr<SpkEphemeris> spk;
+	try {
+		std::string ephemerisPath;
+		if (cmdl("ephemeris") >> ephemerisPath) {
+			ephemeris = std::make_unique<Ephemeris>(ephemerisPath);
+		}
+		std::string spkPaths;
+		if (cmdl("spk") >> spkPaths) {
+			spk = std::make_unique<SpkEphemeris>();
+			std::stringstream kernels(spkPaths);
+			while (std::getline(kernels, token, ',')) {
+				spk->load(token);
+			}
+		}
+	}
+	catch (std::runtime_error&) {
+		return 1;	// already logged
+	}
+	if (!ephemeris && !spk) {
+		Log::error("EPHQUERY needs an --ephemeris, --spk kernels, or both");
+		return 1;
+	}
+
+	std::string format = "csv";
+	cmdl("format", "csv") >> format;
+	if (format != "csv" && format != "binary") {
+		Log::error("EPHQUERY unknown format {}; use csv or binary", format);
+		return 1;
+	}
+	unsigned threads = 0;
+	cmdl("threads", 0) >> threads;
+
+	std::vector<StateQuery::State> states(bodies.size() * epochs.size());
+	auto started = std::chrono::steady_clock::now();
+	size_t missing = StateQuery(ephemeris.get(), spk.get()).run(bodies, center, epochs, states.data(), threads);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	Log::info("EPHQUERY {} states in {:.3f} s ({:.0f} ns each)", states.size(), seconds, 1e9 * seconds / double(states.size()));
+	if (missing > 0) {
+		Log::warn("EPHQUERY {} states aren't covered by the sources and are NaN", missing);
+	}
+
+	std::ofstream output(outputPath, std::ios::binary);
+	if (format == "binary") {
+		Header header;
+		header.bodyCount = uint32_t(bodies.size());
+		header.center = center;
+		header.epochCount = epochs.size();
+		std::vector<int32_t> ids(bodies.begin(), bodies.end());
+		output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		output.write(reinterpret_cast<const char*>(ids.data()), std::streamsize(sizeof(int32_t) * ids.size()));
+		output.write(reinterpret_cast<const char*>(epochs.data()), std::streamsize(sizeof(double) * epochs.size()));
+		output.write(reinterpret_cast<const char*>(states.data()), std::streamsize(sizeof(StateQuery::State) * states.size()));
+	}
+	else {
+		// Shortest digits that read back to the same double; written a block
+		// at a time
+		fmt::memory_buffer buffer;
+		fmt::format_to(buffer, "body,jd,x,y,z,vx,vy,vz\n");
+		for (size_t b = 0; b < bodies.size(); b++) {
+			for (size_t e = 0; e < epochs.size(); e++) {
+				const StateQuery::State& s = states[b * epochs.size() + e];
+				fmt::format_to(buffer, "{},{},{},{},{},{},{},{}\n", bodies[b], epochs[e],
+					s.position.x, s.position.y, s.position.z, s.velocity.x, s.velocity.y, s.velocity.z);
+				if (buffer.size() > (1 << 20)) {
+					output.write(buffer.data(), std::streamsize(buffer.size()));
+					buffer.clear();
+				}
+			}
+		}
+		output.write(buffer.data(), std::streamsize(buffer.size()));
+	}
+	if (!output) {
+		Log::error("EPHQUERY unable to write {}", outputPath);
+		return 1;
+	}
+
+	Log::info("EPHQUERY wrote {} bodies at {} epochs to {}", bodies.size(), epochs.size(), outputPath);
+	return 0;
+}
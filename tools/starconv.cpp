@@ -0,0 +1,227 @@
+//------------------------------------------------------------------------------
+// Converts a text star catalog into the binary format read by StarField.
+//
+// Usage: starconv <catalog.csv> <output.stars> [--max-magnitude 8.0]
+//
+// The input is a CSV file with a header row, such as the HYG database. The
+// columns used are "mag", "ci" (B-V colour index) and either "ra"/"dec" (hours
+// and degrees) or equatorial "x"/"y"/"z". Rows with a "dist" of zero (the Sun)
+// are skipped.
+//------------------------------------------------------------------------------
+
+#include "Log.h"
+#include "StarCatalog.h"
+
+#include <argh.h>
+#include <glm/glm.hpp>
+#include <vivid/vivid.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+	const double PI = 3.14159265358979323846;
+
+	// Mean obliquity of the ecliptic at J2000
+	const double obliquity = 23.4392911 * PI / 180.0;
+
+	const float minColorIndex = -0.4f;
+	const float maxColorIndex = 2.0f;
+	const int lookupSize = 256;
+
+
+	// Black body temperature of a star from its B-V index (Ballesteros, 2012)
+	double temperatureFromColorIndex(double bv) {
+		return 4600.0 * (1.0 / (0.92 * bv + 1.7) + 1.0 / (0.92 * bv + 0.62));
+	}
+
+	// CIE 1931 xy chromaticity of a black body, cubic spline fit to the
+	// Planckian locus (Kim et al., 2002). Valid for 1667 K to 25000 K.
+	glm::dvec2 planckianLocus(double T) {
+		T = std::clamp(T, 1667.0, 25000.0);
+		double T2 = T * T;
+		double T3 = T2 * T;
+
+		double x = T < 4000.0
+			? -0.2661239e9 / T3 - 0.2343589e6 / T2 + 0.8776956e3 / T + 0.179910
+			: -3.0258469e9 / T3 + 2.1070379e6 / T2 + 0.2226347e3 / T + 0.240390;
+		double x2 = x * x;
+		double x3 = x2 * x;
+
+		double y;
+		if (T < 2222.0) {
+			y = -1.1063814 * x3 - 1.34811020 * x2 + 2.18555832 * x - 0.20219683;
+		} else if (T < 4000.0) {
+			y = -0.9549476 * x3 - 1.37418593 * x2 + 2.09137015 * x - 0.16748867;
+		} else {
+			y = 3.0817580 * x3 - 5.87338670 * x2 + 3.75112997 * x - 0.37001483;
+		}
+		return glm::dvec2(x, y);
+	}
+
+	// B-V -> temperature -> chromaticity -> linear RGB at full brightness. The
+	// colours stay linear; the sRGB framebuffer does the encoding when drawn.
+	std::array<vivid::col8_t, lookupSize> bakeColorLookup() {
+		std::array<vivid::col8_t, lookupSize> lookup;
+
+		for (int i = 0; i < lookupSize; i++) {
+			double bv = minColorIndex + (maxColorIndex - minColorIndex) * i / (lookupSize - 1);
+			glm::dvec2 xy = planckianLocus(temperatureFromColorIndex(bv));
+
+			vivid::xyz_t xyz(float(xy.x / xy.y), 1.0f, float((1.0 - xy.x - xy.y) / xy.y));
+			glm::vec3 linear = glm::max(vivid::matrices::xyz_to_rgb * xyz, glm::vec3(0.0f));
+			linear /= std::max(linear.r, std::max(linear.g, linear.b));
+
+			lookup[i] = vivid::rgb8::fromRgb(vivid::lrgb_t(linear.r, linear.g, linear.b));
+		}
+		return lookup;
+	}
+
+
+	// Splits one CSV line, honouring double quotes
+	std::vector<std::string> splitCsv(const std::string& line) {
+		std::vector<std::string> fields(1);
+		bool quoted = false;
+		for (char c : line) {
+			if (c == '"') {
+				quoted = !quoted;
+			} else if (c == ',' && !quoted) {
+				fields.emplace_back();
+			} else if (c != '\r') {
+				fields.back() += c;
+			}
+		}
+		return fields;
+	}
+
+	double toDouble(const std::string& field, double fallback) {
+		char* end = nullptr;
+		double value = std::strtod(field.c_str(), &end);
+		return end == field.c_str() ? fallback : value;
+	}
+}
+
+
+int main(int argc, char** argv) {
+	argh::parser cmdl(argc, argv, argh::parser::PREFER_PARAM_FOR_UNREG_OPTION);
+
+	std::string inputPath, outputPath;
+	if (!(cmdl(1) >> inputPath) || !(cmdl(2) >> outputPath)) {
+		Log::error("usage: starconv <catalog.csv> <output.stars> [--max-magnitude 8.0]");
+		return 1;
+	}
+	float maxMagnitude;
+	cmdl("max-magnitude", 8.0f) >> maxMagnitude;
+
+	std::ifstream input(inputPath);
+	if (!input) {
+		Log::error("STARCONV unable to open {}", inputPath);
+		return 1;
+	}
+
+	std::string line;
+	std::getline(input, line);
+	std::map<std::string, size_t> column;
+	std::vector<std::string> names = splitCsv(line);
+	for (size_t i = 0; i < names.size(); i++) {
+		column[names[i]] = i;
+	}
+
+	bool hasRaDec = column.count("ra") && column.count("dec");
+	bool hasXyz = column.count("x") && column.count("y") && column.count("z");
+	if (!column.count("mag") || !(hasRaDec || hasXyz)) {
+		Log::error("STARCONV {} needs a 'mag' column and either 'ra'/'dec' or 'x'/'y'/'z'", inputPath);
+		return 1;
+	}
+
+	const std::array<vivid::col8_t, lookupSize> colorLookup = bakeColorLookup();
+	const glm::dmat3 equatorialToEcliptic = glm::transpose(glm::dmat3(
+		1.0, 0.0, 0.0,
+		0.0, std::cos(obliquity), std::sin(obliquity),
+		0.0, -std::sin(obliquity), std::cos(obliquity)));
+
+	std::vector<StarCatalog::StarRecord> stars;
+	size_t skipped = 0;
+
+	while (std::getline(input, line)) {
+		std::vector<std::string> fields = splitCsv(line);
+		if (fields.size() < names.size()) {
+			skipped++;
+			continue;
+		}
+		auto field = [&](const char* name, double fallback) {
+			auto it = column.find(name);
+			return it == column.end() ? fallback : toDouble(fields[it->second], fallback);
+		};
+
+		double magnitude = field("mag", 99.0);
+		if (magnitude > maxMagnitude || field("dist", 1.0) == 0.0) {
+			skipped++;
+			continue;
+		}
+
+		glm::dvec3 equatorial;
+		if (hasRaDec) {
+			double ra = field("ra", 0.0) * PI / 12.0;
+			double dec = field("dec", 0.0) * PI / 180.0;
+			equatorial = glm::dvec3(std::cos(dec) * std::cos(ra), std::cos(dec) * std::sin(ra), std::sin(dec));
+		} else {
+			equatorial = glm::dvec3(field("x", 0.0), field("y", 0.0), field("z", 0.0));
+		}
+		if (glm::length(equatorial) == 0.0) {
+			skipped++;
+			continue;
+		}
+		glm::dvec3 direction = glm::normalize(equatorialToEcliptic * equatorial);
+
+		// Stars with no measured colour index are treated as white (B-V ~ 0.3)
+		double bv = std::clamp(field("ci", 0.3), double(minColorIndex), double(maxColorIndex));
+		int index = int(std::lround((bv - minColorIndex) / (maxColorIndex - minColorIndex) * (lookupSize - 1)));
+
+		StarCatalog::StarRecord star{};
+		star.direction[0] = float(direction.x);
+		star.direction[1] = float(direction.y);
+		star.direction[2] = float(direction.z);
+		star.magnitude = float(magnitude);
+		star.color[0] = colorLookup[index].r;
+		star.color[1] = colorLookup[index].g;
+		star.color[2] = colorLookup[index].b;
+		stars.push_back(star);
+	}
+
+	// Brightest first, so a magnitude cut is also a prefix of the file
+	std::sort(stars.begin(), stars.end(), [](const StarCatalog::StarRecord& a, const StarCatalog::StarRecord& b) {
+		return a.magnitude < b.magnitude;
+	});
+
+	StarCatalog::Header header{};
+	std::copy(std::begin(StarCatalog::magic), std::end(StarCatalog::magic), header.magic);
+	header.version = StarCatalog::version;
+	header.count = uint32_t(stars.size());
+	header.recordSize = sizeof(StarCatalog::StarRecord);
+
+	std::filesystem::path parent = std::filesystem::path(outputPath).parent_path();
+	if (!parent.empty()) {
+		std::filesystem::create_directories(parent);
+	}
+
+	std::ofstream output(outputPath, std::ios::binary);
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	output.write(reinterpret_cast<const char*>(stars.data()), sizeof(StarCatalog::StarRecord) * stars.size());
+	if (!output) {
+		Log::error("STARCONV unable to write {}", outputPath);
+		return 1;
+	}
+
+	Log::info("STARCONV wrote {} stars to {} ({} rows skipped)", stars.size(), outputPath, skipped);
+	return 0;
+}